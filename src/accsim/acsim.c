@@ -4363,11 +4363,10 @@ void EmitUpdateMethod( FILE *output){
   /*   fprintf( output, "%sdo_it = do_it.read()^1;\n", INDENT[2]); */
   /*   fprintf( output, "%s}\n", INDENT[1]); */
 
+  //Only levels with a posted request are serviced, through the completion queue.
   if( HaveMemHier ){
-    for( pstorage = storage_list; pstorage!= NULL; pstorage = pstorage->next ) {
-      if( pstorage->type == CACHE || pstorage->type == ICACHE || pstorage->type == DCACHE || pstorage->type == MEM )
-        fprintf( output, "%s%s.process_request( );\n", INDENT[1], pstorage->name);
-    }
+    fprintf( output, "%sif (ac_cache_if::pending)\n", INDENT[1]);
+    fprintf( output, "%sac_cache_if::process_pending( );\n", INDENT[2]);
   }
   fprintf( output, "%sdo_it = do_it ^1;\n", INDENT[1]);
   fprintf( output, "%s}\n", INDENT[0]);
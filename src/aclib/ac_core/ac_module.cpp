@@ -58,8 +58,35 @@ unsigned ac_module::running_mods = 0;
 /// List of all modules.
 std::list<ac_module*> ac_module::mods_list;
 
+/// Quantum handshake between SystemC and the host threads.
+pthread_mutex_t ac_module::quantum_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t ac_module::quantum_cond = PTHREAD_COND_INITIALIZER;
+std::vector<ac_module*> ac_module::quantum_mods;
+bool ac_module::stop_pending = false;
+
+/// No feature in use requires serial simulation yet.
+const char* ac_module::serial_reason = NULL;
+
+/// Interactions between modules seen so far.
+unsigned ac_module::interactions = 0;
+ac_module::page_owner ac_module::page_owners[AC_PAGE_OWNERS];
+
+/// Parallel mode is off unless set_parallel() is called.
+bool ac_module::parallel_mode = false;
+pthread_mutex_t ac_module::shared_lock = PTHREAD_MUTEX_INITIALIZER;
+
 /// Standard constructor.
-ac_module::ac_module() : sc_module(sc_gen_unique_name("ac_module")),
+ac_module::ac_module() :
+#ifndef AC_NO_SYSTEMC
+			 sc_module(sc_gen_unique_name("ac_module")),
+#endif
+			 host_started(false),
+			 host_finished(false),
+			 quantum_go(false),
+			 quantum_done(false),
+			 instr_batch_min(500),
+			 instr_batch_max(500),
+			 seen_interactions(0),
 			 mod_id(next_mod_id++),
 			 ac_exit_status(0),
 			 instr_in_batch(0),
@@ -69,7 +96,17 @@ ac_module::ac_module() : sc_module(sc_gen_unique_name("ac_module")),
 }
 
 /// Named constructor.
-ac_module::ac_module(sc_module_name nm) : sc_module(nm),
+ac_module::ac_module(sc_module_name nm) :
+#ifndef AC_NO_SYSTEMC
+			 sc_module(nm),
+#endif
+			 host_started(false),
+			 host_finished(false),
+			 quantum_go(false),
+			 quantum_done(false),
+			 instr_batch_min(500),
+			 instr_batch_max(500),
+			 seen_interactions(0),
 			 mod_id(next_mod_id++),
 			 ac_exit_status(0),
 			 instr_in_batch(0),
@@ -92,6 +129,12 @@ void ac_module::PrintStat()
   return;
 }
 
+/// Instruction loop placeholder.
+void ac_module::behavior()
+{
+  return;
+}
+
 /// Callable PrintStat-like method.
 void ac_module::PrintAllStats()
 {
@@ -104,20 +147,233 @@ void ac_module::PrintAllStats()
 
 /// Public method that registers module as a running module.
 void ac_module::set_running() {
+  pthread_mutex_lock(&quantum_lock);
   running_mods++;
+  pthread_mutex_unlock(&quantum_lock);
 }
 
 /// Public method that unregisters module (ie, it's no longer running).
 void ac_module::set_stopped() {
+  pthread_mutex_lock(&quantum_lock);
   if (--running_mods == 0) {
-    dup2(2, 1); //any output to stdout is redirected for stderr (ex. SystemC stop message)
-    sc_stop();
+    //sc_stop() is left to the SystemC thread when stopping from a host thread
+    if (host_started && pthread_equal(pthread_self(), host_thread))
+      stop_pending = true;
+    else {
+#ifndef AC_NO_SYSTEMC
+      dup2(2, 1); //any output to stdout is redirected for stderr (ex. SystemC stop message)
+      sc_stop();
+#endif
+    }
   }
+  pthread_mutex_unlock(&quantum_lock);
 }
 
 /// Public method that sets the size of the uninterrupted instruction batch
 void ac_module::set_instr_batch_size(unsigned int size)
 {
-  instr_batch_size = size;
+  instr_batch_size = instr_batch_min = instr_batch_max = size;
+}
+
+/// Lets the batch size adapt between min and max
+void ac_module::set_instr_batch_size(unsigned int min, unsigned int max)
+{
+  instr_batch_min = min;
+  instr_batch_max = max;
+  if (instr_batch_size < min)
+    instr_batch_size = min;
+  if (instr_batch_size > max)
+    instr_batch_size = max;
+}
+
+/// Called by the instruction loop at the end of each batch
+void ac_module::adapt_instr_batch_size()
+{
+  if (instr_batch_min == instr_batch_max)
+    return;
+
+  if (interactions != seen_interactions) {
+    // Other modules or devices are talking to us: interleave more finely.
+    seen_interactions = interactions;
+    instr_batch_size /= 2;
+    if (instr_batch_size < instr_batch_min)
+      instr_batch_size = instr_batch_min;
+  }
+  else {
+    // Nobody talked to us during the batch: switch less often.
+    if (instr_batch_size > instr_batch_max / 2)
+      instr_batch_size = instr_batch_max;
+    else
+      instr_batch_size *= 2;
+  }
+}
+
+/// Reports a TLM transport from initiator to address of target
+void ac_module::note_transport(const void* initiator, const void* target,
+                               uint32_t address)
+{
+  uint32_t page = address >> AC_PAGE_OWNER_BITS;
+  page_owner& owner = page_owners[(page ^ ((uintptr_t) target >> 4)) % AC_PAGE_OWNERS];
+
+  if ((owner.target != target) || (owner.page != page)) {
+    owner.target = target;
+    owner.page = page;
+  }
+  else if (owner.initiator != initiator)
+    interactions++;
+  owner.initiator = initiator;
+}
+
+/// Reports an interrupt delivered to a module
+void ac_module::note_interrupt()
+{
+  interactions++;
+}
+
+/// Queues an interrupt for the next quantum of this module in parallel mode.
+bool ac_module::post_interrupt(void (*deliver)(void* port, uint32_t value), void* port,
+                               uint32_t value)
+{
+  pending_interrupt intr;
+
+  if (!parallel_mode)
+    return false;
+
+  intr.deliver = deliver;
+  intr.port = port;
+  intr.value = value;
+  pthread_mutex_lock(&quantum_lock);
+  pending_interrupts.push_back(intr);
+  pthread_mutex_unlock(&quantum_lock);
+  return true;
+}
+
+/// Runs every module on its own host thread, synchronizing once per batch.
+void ac_module::set_parallel(bool on)
+{
+  parallel_mode = on;
+}
+
+/// Turns parallel mode off when simulation starts.
+void ac_module::keep_serial(const char* reason)
+{
+  if (serial_reason == NULL)
+    serial_reason = reason;
+}
+
+/// Moves the instruction loop to a host thread and drives it from the
+/// SystemC thread, one quantum per nanosecond of simulated time.
+bool ac_module::run_on_host_thread()
+{
+#ifdef AC_NO_SYSTEMC
+  // Standalone simulators have no kernel to synchronize with.
+  return false;
+#else
+  // Every init() ran before the kernel started, so all the modules see
+  // the same decision here, before any host thread exists.
+  if (parallel_mode && serial_reason != NULL) {
+    std::cerr << "ArchC: Parallel mode is off, as " << serial_reason
+              << " is not thread safe." << std::endl;
+    parallel_mode = false;
+  }
+
+  // The host thread runs behavior() too, and must fall through.
+  if (!parallel_mode || host_started)
+    return false;
+
+  host_started = true;
+  pthread_create(&host_thread, NULL, host_thread_main, this);
+
+  for (;;) {
+    quantum_mods.push_back(this);
+
+    // Lets every module reaching this time join the quantum, which is then
+    // run by whichever module gets here first, with the kernel held.
+    wait(SC_ZERO_TIME);
+    run_quantum();
+
+    if (stop_pending) {
+      stop_pending = false;
+      dup2(2, 1);
+      sc_stop();
+    }
+    if (host_finished)
+      break;
+
+    wait(1, SC_NS);
+  }
+
+  pthread_join(host_thread, NULL);
+  return true;
+#endif
 }
 
+/// Runs one quantum of every module in quantum_mods, in parallel.
+void ac_module::run_quantum()
+{
+  std::vector<ac_module*>::iterator i;
+
+  if (quantum_mods.empty())
+    return;
+
+  pthread_mutex_lock(&quantum_lock);
+  for (i = quantum_mods.begin(); i != quantum_mods.end(); i++) {
+    (*i)->quantum_done = false;
+    (*i)->quantum_go = true;
+  }
+  pthread_cond_broadcast(&quantum_cond);
+
+  for (i = quantum_mods.begin(); i != quantum_mods.end(); i++)
+    while (!(*i)->quantum_done)
+      pthread_cond_wait(&quantum_cond, &quantum_lock);
+  pthread_mutex_unlock(&quantum_lock);
+
+  quantum_mods.clear();
+}
+
+/// Blocks the host thread until its module gets a new quantum.
+void ac_module::wait_quantum()
+{
+  std::vector<pending_interrupt> intrs;
+  std::vector<pending_interrupt>::iterator i;
+
+  pthread_mutex_lock(&quantum_lock);
+  while (!quantum_go)
+    pthread_cond_wait(&quantum_cond, &quantum_lock);
+  quantum_go = false;
+  intrs.swap(pending_interrupts);
+  pthread_mutex_unlock(&quantum_lock);
+
+  // The handlers write the registers of this module, so they run here, on
+  // its own host thread, between two of its batches.
+  for (i = intrs.begin(); i != intrs.end(); i++)
+    i->deliver(i->port, i->value);
+}
+
+/// Called by the instruction loop at the end of each batch in parallel mode.
+void ac_module::end_quantum()
+{
+  pthread_mutex_lock(&quantum_lock);
+  quantum_done = true;
+  pthread_cond_broadcast(&quantum_cond);
+  pthread_mutex_unlock(&quantum_lock);
+
+  wait_quantum();
+}
+
+/// Entry point of the host threads.
+void* ac_module::host_thread_main(void* mod)
+{
+  ac_module* m = (ac_module*) mod;
+
+  m->wait_quantum();
+  m->behavior();
+
+  pthread_mutex_lock(&quantum_lock);
+  m->host_finished = true;
+  m->quantum_done = true;
+  pthread_cond_broadcast(&quantum_cond);
+  pthread_mutex_unlock(&quantum_lock);
+
+  return NULL;
+}
@@ -16,9 +16,9 @@
  * @date      Mon, 19 Jun 2006 15:33:19 -0300
  *
  * @brief     Breakpoint support
- *            This class implements breakpoint support, actually it's 
- *            just a vector that keeps crescent order of elements and 
- *            have exits() method. It should be replaced for STL in future.
+ *            This class implements breakpoint support: a set of
+ *            addresses with a per-page bitmap in front of it, so
+ *            exists() is cheap for addresses with no breakpoint around.
  *
  * @attention Copyright (C) 2002-2006 --- The ArchC Team
  * 
@@ -43,11 +43,13 @@
  * \li Commenting style. This code use doxygen (http://www.doxygen.org)
  *     to be documented.
  *
- * \todo  This class should be replaced for standard STL element.
  */
 
 #include "breakpoints.H"
 
+/** Size in bytes of the page bitmap, for the whole 32-bit address space */
+#define BP_BITMAP_SIZE ( ( 1U << ( 32 - BP_PAGE_BITS ) ) / 8 )
+
 /**
  * Constructor
  *
@@ -55,13 +57,7 @@
  */
 Breakpoints::Breakpoints(int quant) {
   quantMax = quant;
-  if ( ( bp = (unsigned int *) calloc( quantMax,
-				       sizeof( unsigned int ) ) ) == NULL )
-    {
-      perror( "Couldn't allocate breakpoint array." );
-      quantMax = 0;
-    }
-  memset( bp, 255, sizeof(unsigned int)* quantMax );
+  pages = NULL;
   this->quant = 0; /* no breakpoints at start up */
 }
 
@@ -70,8 +66,8 @@ Breakpoints::Breakpoints(int quant) {
  * Destructor
  */
 Breakpoints::~Breakpoints() {
-  if ( bp ) free( bp );
-  bp = NULL;
+  if ( pages ) free( pages );
+  pages = NULL;
 }
 
 
@@ -83,21 +79,22 @@ Breakpoints::~Breakpoints() {
  * \param 0 on success, -1 otherwise
  */
 int Breakpoints::add(unsigned int address) {
-  int i, tmp;
+  unsigned int page = address >> BP_PAGE_BITS;
 
-  if ( ( ! bp ) || ( quant >= quantMax ) )
+  if ( quant >= quantMax )
     return -1;
 
-  for ( i = 0; i < quant; i++ )
-    /* Insert in order */
-    if ( address < bp[i] )
-      {
-	tmp     = address;
-	address = bp[i];
-	bp[i]   = tmp;
-      }
+  /* calloc() maps zero pages: only the bytes written are ever backed */
+  if ( ( ! pages ) &&
+       ( ( pages = (unsigned char *) calloc( BP_BITMAP_SIZE, 1 ) ) == NULL ) )
+    {
+      perror( "Couldn't allocate breakpoint bitmap." );
+      return -1;
+    }
 
-  bp[ quant ++ ] = address;
+  if ( bp.insert( address ).second )
+    quant ++;
+  pages[ page >> 3 ] |= 1 << ( page & 7 );
   return 0;
 }
 
@@ -110,47 +107,18 @@ int Breakpoints::add(unsigned int address) {
  * \param 0 on success, -1 otherwise
  */
 int Breakpoints::remove(unsigned int address) {
-  int i;
+  unsigned int page = address >> BP_PAGE_BITS;
+  unsigned int first = page << BP_PAGE_BITS;
+  set<unsigned int>::iterator next;
 
-  if ( ( ! bp ) || ( quant >= quantMax ) )
+  if ( ! bp.erase( address ) )
     return -1;
+  quant --;
 
-  for ( i = 0; i < quant; i ++ )
-    if ( bp[ i ] == address )
-      {
-	/* Copy remaining breakpoints: [ a | b | c ] => [ a | c ] */
-	for ( ; i < ( quant - 1 ); i ++ )
-	  bp[ i ] = bp[ i + 1 ];
-
-	quant --;
-	return 0;
-      }
-
-  return -1;
-}
-
-/**
- * Check if breakpoint exists
- *
- * \param address the address to be checked
- *
- * \return 1 if there is a breakpoint, 0 otherwise
- */
-int Breakpoints::exists(unsigned int address) {
-  int i;
-
-  if ( ( ! bp ) || ( quant >= quantMax ) )
-    return 0;
-
-  for ( i = 0; i < quant; i ++ )
-    if ( address == bp[ i ] )
-      return 1;
-    else
-      /* bp is crescent order, so if current element is greater than desired
-       * address, there's no address in list
-       */
-      if (  bp[ i ] > address )
-	return 0;
+  /* Clear the page bit if that was its last breakpoint */
+  next = bp.lower_bound( first );
+  if ( ( next == bp.end() ) || ( ( *next >> BP_PAGE_BITS ) != page ) )
+    pages[ page >> 3 ] &= ~( 1 << ( page & 7 ) );
 
   return 0;
 }
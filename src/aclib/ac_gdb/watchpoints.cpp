@@ -0,0 +1,163 @@
+/**
+ * @file      watchpoints.cpp
+ * @author    The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ * @date      Mon, 19 Oct 2026 21:14:37 -0300
+ *
+ * @brief     Watchpoint support
+ *            This class implements write, read and access watchpoints:
+ *            a short list of watched ranges with a per-page bitmap in
+ *            front of it, so unwatched accesses are cheap.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * \note When modifing this file respect:
+ * \li License
+ * \li Previous author names. Add your own after current ones.
+ * \li Coding style (basically emacs style)
+ * \li Commenting style. This code use doxygen (http://www.doxygen.org)
+ *     to be documented.
+ *
+ */
+
+#include "watchpoints.H"
+
+std::vector<Watchpoints::watch> Watchpoints::watches;
+unsigned char Watchpoints::pages[ ( 1U << ( 32 - WP_PAGE_BITS ) ) / 8 ];
+bool Watchpoints::triggered = false;
+volatile sig_atomic_t* Watchpoints::hit_flag = NULL;
+int Watchpoints::hit_type = 0;
+unsigned int Watchpoints::hit_address = 0;
+
+
+/**
+ * Set or clear the page bits of a watched range. An access starting up to
+ * WP_MAX_ACCESS - 1 bytes before the range may still hit it, so the page
+ * holding that address is marked too.
+ *
+ * \param w the watched range
+ * \param set true to set the bits, false to clear them
+ */
+void Watchpoints::mark( const watch& w, bool set ) {
+  unsigned int first, last, page;
+
+  first = ( w.address < WP_MAX_ACCESS - 1 ) ? 0 : w.address - ( WP_MAX_ACCESS - 1 );
+  last = w.address + w.length - 1;
+  if ( last < w.address )
+    last = ~0U; /* range wraps around the address space */
+
+  for ( page = first >> WP_PAGE_BITS; page <= ( last >> WP_PAGE_BITS ); page ++ )
+    if ( set )
+      pages[ page >> 3 ] |= 1 << ( page & 7 );
+    else
+      pages[ page >> 3 ] &= ~( 1 << ( page & 7 ) );
+}
+
+
+/**
+ * Add watchpoint
+ *
+ * \param type WRITE, READ or ACCESS
+ * \param address first byte watched
+ * \param length how many bytes are watched
+ *
+ * \return 0 on success, -1 otherwise
+ */
+int Watchpoints::add( int type, unsigned int address, unsigned int length ) {
+  watch w;
+
+  if ( ( type != WRITE ) && ( type != READ ) && ( type != ACCESS ) )
+    return -1;
+
+  w.type = type;
+  w.address = address;
+  w.length = length ? length : 1;
+  watches.push_back( w );
+  mark( w, true );
+  return 0;
+}
+
+
+/**
+ * Remove watchpoint
+ *
+ * \param type WRITE, READ or ACCESS
+ * \param address first byte watched
+ * \param length how many bytes are watched
+ *
+ * \return 0 on success, -1 otherwise
+ */
+int Watchpoints::remove( int type, unsigned int address, unsigned int length ) {
+  unsigned int i;
+
+  if ( ! length )
+    length = 1;
+
+  for ( i = 0; i < watches.size(); i ++ )
+    if ( ( watches[ i ].type == type ) && ( watches[ i ].address == address ) &&
+         ( watches[ i ].length == length ) )
+      break;
+
+  if ( i == watches.size() )
+    return -1;
+
+  /* Clear the pages of the range, then mark again the ones still
+     watched by others: there are only a few watchpoints */
+  mark( watches[ i ], false );
+  watches.erase( watches.begin() + i );
+  for ( i = 0; i < watches.size(); i ++ )
+    mark( watches[ i ], true );
+
+  return 0;
+}
+
+
+/**
+ * Record a hit if an access overlaps a watchpoint of the matching type.
+ * Called by ac_memport when watched() is true.
+ *
+ * \param address first byte accessed
+ * \param length how many bytes are accessed
+ * \param write true for a write, false for a read
+ */
+void Watchpoints::check( unsigned int address, unsigned int length, bool write ) {
+  unsigned int i;
+
+  if ( triggered )
+    return;
+
+  for ( i = 0; i < watches.size(); i ++ ) {
+    const watch& w = watches[ i ];
+
+    if ( ( w.type == ( write ? READ : WRITE ) ) ||
+         ( address - w.address >= w.length && w.address - address >= length ) )
+      continue;
+
+    triggered = true;
+    hit_type = w.type;
+    hit_address = ( address > w.address ) ? address : w.address;
+    if ( hit_flag )
+      *hit_flag = 1;
+    return;
+  }
+}
@@ -36,23 +36,34 @@
 
 
 #include <stdlib.h>
+#include <stdio.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <vector>
 #include "ac_utils.H"
 
 
 #include "ac_rtld.H"
 #include "link_node.H"
+#include "ac_checkpoint.H"
+#include "ac_timing.H"
 
 
 namespace ac_dynlink {
 
+  bool ac_rtld::lazy_binding = false;
+  bool ac_rtld::lazy_traps = false;
+  char *ac_rtld::cache_dir = NULL;
+
   ac_rtld::ac_rtld() {
     root = NULL;
     initiated = false;
     glibc = false;
     word_size = 0;
+    lazy_base = 0;
+    lazy_size = 0;
   }
   
   ac_rtld::~ac_rtld() {
@@ -156,6 +167,7 @@ namespace ac_dynlink {
       mem_map.set_memsize(memsize);
       mem_map.add_region(start_addr, size);
       mem_map.set_brk_addr(brkaddr);
+      exe_id = file_id(fd);
       detect_static_glibc(fd, match_endian);
     }
   }
@@ -166,6 +178,8 @@ namespace ac_dynlink {
 			 unsigned char word_size, bool match_endian, Elf32_Word mem_size,
 			 unsigned int& ac_heap_ptr) {
     unsigned *initvec, initvecn;
+    bool cached = (cache_dir != NULL) && !exe_id.empty();
+    std::string key, file;
     this->word_size = word_size;
     this->glibc = true;
     
@@ -175,9 +189,52 @@ namespace ac_dynlink {
       root = new link_node(NULL, NULL);
     root->set_root(root);
     root->set_program_interpreter(pinterp);
+
+    /* An image linked by an earlier run of the same application replaces
+       loading and linking altogether. Its file is named after an FNV-1a
+       hash of the key, which is checked in full when it is read. */
+    if (cached) {
+      unsigned long long hash = 14695981039346656037ULL;
+      char name[32];
+      unsigned i;
+      bool hit;
+
+      key = cache_key(dynaddr, pinterp, word_size, match_endian, mem_size);
+      for (i = 0; i < key.size(); i++)
+        hash = (hash ^ (unsigned char) key[i]) * 1099511628211ULL;
+      snprintf(name, sizeof(name), "/%016llx.rtld", hash);
+      file = std::string(cache_dir) + name;
+
+      ac_timing::phase caller = ac_timing::enter(ac_timing::LINK);
+      hit = load_cache(file, key, mem, mem_size, start_addr, ac_heap_ptr);
+      ac_timing::enter(caller);
+      if (hit) {
+        AC_SAY("Using linked image from cache: " << file);
+        return;
+      }
+    }
+
     root->link_node_setup(dynaddr, mem, 0, ET_EXEC, NULL, NULL, match_endian);
     
+    ac_timing::phase caller = ac_timing::enter(ac_timing::LINK);
     load_libraries(mem, mem_size);
+
+    /* With lazy binding, every PLT slot gets a trap address of its
+       own, in a region reserved before the heap. A cached image must
+       be fully bound, so the cache turns lazy binding off. */
+    if (lazy_binding && !cached) {
+      link_node *p;
+      Elf32_Word slots = 0;
+
+      for (p = root; p != NULL; p = p->get_next())
+        slots += p->count_jump_slots();
+      if (slots != 0) {
+        lazy_size = slots * LAZY_SLOT_SIZE;
+        lazy_base = mem_map.suggest_free_region(lazy_size);
+        mem_map.add_region(lazy_base, lazy_size);
+        root->set_lazy_base(lazy_base);
+      }
+    }
     
     ac_heap_ptr = mem_map.suggest_free_region(0);
 
@@ -195,13 +252,260 @@ namespace ac_dynlink {
         initvec[i] = initvec[i+1];
       initvec[i] = tmp;
     }
+
+    if (cached)
+      save_cache(file, key, mem, mem_size, start_addr, ac_heap_ptr);
+    ac_timing::enter(caller);
   }
   
 
+  /* Identity of an open file, changing whenever the file is replaced or
+     modified. Empty if fd is not valid. */
+  std::string ac_rtld::file_id(int fd) {
+    struct stat st;
+    char buf[96];
+
+    if (fd < 0 || fstat(fd, &st) != 0)
+      return std::string();
+    snprintf(buf, sizeof(buf), "%llx:%llx:%llx:%llx", (unsigned long long) st.st_dev,
+             (unsigned long long) st.st_ino, (unsigned long long) st.st_size,
+             (unsigned long long) st.st_mtime);
+    return buf;
+  }
+
+  /* Everything the linked image depends on, besides the libraries
+     themselves: the executable, where it is loaded and how libraries
+     are searched for. */
+  std::string ac_rtld::cache_key(Elf32_Addr dynaddr, const char *pinterp, unsigned char word_size,
+                                 bool match_endian, Elf32_Word mem_size) {
+    const char *libpath = getenv(ENV_AC_LIBRARY_PATH);
+    char buf[64];
+    std::string key = "ac_rtld image 1\n";
+
+    key += exe_id;
+    snprintf(buf, sizeof(buf), "\n%x %x %u %d %d\n", dynaddr, mem_size, word_size,
+             match_endian, rtld_config.is_config_loaded());
+    key += buf;
+    key += pinterp ? pinterp : "";
+    key += '\n';
+    key += libpath ? libpath : "";
+    return key;
+  }
+
+  /* Largest string or list length read from a cache file */
+#define CACHE_LENGTH_MAX 65536
+
+  /* Saves or restores a string, preceded by its length. On restore,
+     returns false if the length is not plausible. */
+  static bool cache_string(ac_checkpoint& ck, std::string& s) {
+    uint32_t len = s.size();
+
+    ck.value(len);
+    if (len > CACHE_LENGTH_MAX)
+      return false;
+    s.resize(len);
+    if (len)
+      ck.data(&s[0], len);
+    return true;
+  }
+
+  /* Saves or restores a linked image: the key, the files it was built from,
+     the entry point, the heap start, the init and fini functions, the
+     memory map and the memory below the heap. On restore, returns false
+     if the file is unreadable or the key or any of those files differ;
+     with mem NULL, only checks the file and changes nothing. */
+  bool ac_rtld::cache_image(ac_checkpoint& ck, const std::string& key, unsigned char *mem,
+                            Elf32_Word mem_size, Elf32_Addr& start_addr,
+                            unsigned int& ac_heap_ptr) {
+    std::vector<std::string> names;
+    std::vector<unsigned> vec;
+    std::string text, id;
+    Elf32_Addr start = start_addr;
+    unsigned int heap = ac_heap_ptr;
+    unsigned count, initsz, finisz, i;
+    memmap check_map;
+    link_node *p;
+    int fd;
+
+    ck.section("rtld cache");
+    text = key;
+    if (!cache_string(ck, text) || text != key)
+      return false;
+
+    /* Every library loaded, found again the same way, and the
+       relocation map */
+    if (ck.saving()) {
+      for (p = root->get_next(); p != NULL; p = p->get_next())
+        names.push_back((char *) p->get_soname());
+      if (rtld_config.is_config_loaded())
+        names.push_back("ac_rtld.relmap");
+    }
+    count = names.size();
+    ck.value(count);
+    if (count > CACHE_LENGTH_MAX)
+      return false;
+    names.resize(count);
+    for (i = 0; i < count; i++) {
+      if (!cache_string(ck, names[i]) || !ck.ok())
+        return false;
+      fd = dynamic_info::find_library(names[i].c_str());
+      id = file_id(fd);
+      if (fd >= 0)
+        close(fd);
+      text = id;
+      if (!cache_string(ck, text) || id.empty() || text != id)
+        return false;
+    }
+
+    ck.value(start);
+    ck.value(heap);
+    if (heap > mem_size)
+      return false;
+
+    initsz = get_init_arraysz();
+    finisz = get_fini_arraysz();
+    ck.value(initsz);
+    ck.value(finisz);
+    if (initsz > CACHE_LENGTH_MAX || finisz > CACHE_LENGTH_MAX)
+      return false;
+    vec.resize(initsz + finisz);
+    if (ck.saving()) {
+      for (i = 0; i < initsz; i++)
+        vec[i] = get_init_array()[i];
+      for (i = 0; i < finisz; i++)
+        vec[initsz + i] = get_fini_array()[i];
+    }
+    if (!vec.empty())
+      ck.data(&vec[0], vec.size() * sizeof(unsigned));
+
+    if (!ck.saving() && mem == NULL)
+      check_map.checkpoint(ck);
+    else
+      mem_map.checkpoint(ck);
+    ck.sparse(mem, heap);
+    if (ck.saving() || mem == NULL || !ck.ok())
+      return ck.ok();
+
+    start_addr = start;
+    ac_heap_ptr = heap;
+    for (i = 0; i < initsz; i++)
+      root->add_to_start_vector(vec[i]);
+    for (i = 0; i < finisz; i++)
+      root->add_to_fini_vector(vec[initsz + i]);
+    return true;
+  }
+
+  /* Reads the linked image from file into mem, if it exists and still
+     matches the application and its libraries. The whole file is read
+     once before anything is restored, so a truncated or corrupt image
+     is only a miss. */
+  bool ac_rtld::load_cache(const std::string& file, const std::string& key, unsigned char *mem,
+                           Elf32_Word mem_size, Elf32_Addr& start_addr,
+                           unsigned int& ac_heap_ptr) {
+    struct stat st;
+
+    if (stat(file.c_str(), &st) != 0)
+      return false;
+    ac_checkpoint ck(file.c_str(), false, false);
+    if (!ck.ok() || !cache_image(ck, key, NULL, mem_size, start_addr, ac_heap_ptr))
+      return false;
+    ck.rewind();
+    return cache_image(ck, key, mem, mem_size, start_addr, ac_heap_ptr);
+  }
+
+  /* Writes the linked image to file. It is written under a temporary
+     name first, so other runs never read a partial image. */
+  void ac_rtld::save_cache(const std::string& file, const std::string& key, unsigned char *mem,
+                           Elf32_Word mem_size, Elf32_Addr& start_addr,
+                           unsigned int& ac_heap_ptr) {
+    char suffix[32];
+    std::string tmp;
+
+    if (access(cache_dir, W_OK) != 0) {
+      AC_WARN("Cannot write linked images to " << cache_dir << ".");
+      return;
+    }
+    snprintf(suffix, sizeof(suffix), ".%d", (int) getpid());
+    tmp = file + suffix;
+    {
+      ac_checkpoint ck(tmp.c_str(), true);
+      cache_image(ck, key, mem, mem_size, start_addr, ac_heap_ptr);
+    }
+    if (rename(tmp.c_str(), file.c_str()) != 0)
+      unlink(tmp.c_str());
+  }
+
+
+  /* Binds the PLT slot whose trap address the simulator reached.
+     Returns the address of the function to jump to. */
+  Elf32_Addr ac_rtld::bind(Elf32_Addr trap) {
+    Elf32_Addr target;
+
+    ac_timing::phase caller = ac_timing::enter(ac_timing::LINK);
+    target = root->bind_lazy_slot(trap, word_size);
+    ac_timing::enter(caller);
+    return target;
+  }
 
   bool ac_rtld::is_glibc() {
     return this->glibc;
   }
+
+  /* Saves or restores what the program changes after loading: the init and
+     fini functions not run yet and the memory map. The link tree itself is
+     rebuilt when the application is loaded again before a restore, and
+     must leave the same PLT slots for lazy binding, since the GOT of the
+     checkpoint still points at their trap addresses. */
+  void ac_rtld::checkpoint(ac_checkpoint& ck) {
+    unsigned initsz = get_init_arraysz();
+    unsigned finisz = get_fini_arraysz();
+    unsigned loaded_initsz = initsz, loaded_finisz = finisz;
+    bool lazy = lazy_binding;
+    Elf32_Addr base = lazy_base;
+    Elf32_Word size = lazy_size;
+    unsigned slots = (root != NULL) ? root->get_lazy_slot_n() : 0;
+    unsigned i, reloc;
+
+    ck.section("rtld");
+    ck.value(glibc);
+
+    ck.value(lazy);
+    ck.value(base);
+    ck.value(size);
+    ck.value(slots);
+    if (lazy != lazy_binding) {
+      AC_ERROR("Checkpoint was saved " << (lazy ? "with" : "without") << " --lazy-bind.");
+      exit(EXIT_FAILURE);
+    }
+    if (base != lazy_base || size != lazy_size ||
+        slots != ((root != NULL) ? root->get_lazy_slot_n() : 0)) {
+      AC_ERROR("Checkpoint does not match the lazy PLT slots of the loaded application.");
+      exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < slots; i++) {
+      reloc = root->get_lazy_slot_reloc(i);
+      ck.value(reloc);
+      if (reloc != root->get_lazy_slot_reloc(i)) {
+        AC_ERROR("Checkpoint does not match the lazy PLT slots of the loaded application.");
+        exit(EXIT_FAILURE);
+      }
+    }
+
+    ck.value(initsz);
+    ck.value(finisz);
+    if (initsz > loaded_initsz || finisz > loaded_finisz) {
+      AC_ERROR("Checkpoint does not match the loaded application.");
+      exit(EXIT_FAILURE);
+    }
+    if (initsz)
+      ck.data(get_init_array(), initsz * sizeof(unsigned));
+    if (finisz)
+      ck.data(get_fini_array(), finisz * sizeof(unsigned));
+    set_init_arraysz(initsz);
+    set_fini_arraysz(finisz);
+
+    mem_map.checkpoint(ck);
+  }
   
   
   bool ac_rtld::detect_static_glibc(int fd, bool match_endian) {
@@ -137,9 +137,35 @@ namespace ac_dynlink {
     return symbol;
   }
 
+  /* Hash table words are stored in target endianness */
+  Elf32_Word dynamic_symbol_table::read_word(Elf32_Word *p) {
+    return convert_endian(4, *p, match_endian);
+  }
+
+  /* DT_GNU_HASH does not tell how many symbols there are. The
+     highest index is in the chain that starts last, and its hash
+     value has the lowest bit set. */
+  unsigned int dynamic_symbol_table::count_gnu_symbols() {
+    unsigned int i, symndx, last = 0;
+
+    for (i = 0; i < nbuckets; i++) {
+      symndx = read_word(&buckets[i]);
+      if (symndx > last)
+        last = symndx;
+    }
+
+    if (last < gnu_symoffset)
+      return gnu_symoffset;
+
+    while ((read_word(&chain[last - gnu_symoffset]) & 1) == 0)
+      last++;
+    return last + 1;
+  }
+
   /* Public methods */
 
   dynamic_symbol_table::dynamic_symbol_table() {
+    has_gnu_hash = false;
     versym = NULL;
     verneed = NULL;
     verdefs = NULL;
@@ -166,18 +192,51 @@ namespace ac_dynlink {
     return hash;
   }
 
+  /* GNU hashing function (DJB), as used by DT_GNU_HASH */
+  unsigned int dynamic_symbol_table::gnu_hash (const unsigned char *name) {
+    Elf32_Word hash = 5381;
+
+    while (*name != '\0')
+      hash = hash * 33 + *name++;
+    return hash;
+  }
+
   void dynamic_symbol_table::setup_hash(unsigned char *mem, Elf32_Addr hash_addr,
-					Elf32_Addr symtab_addr, Elf32_Addr strtab_addr, Elf32_Addr verdef_addr,
+					Elf32_Addr gnu_hash_addr, Elf32_Addr symtab_addr,
+					Elf32_Addr strtab_addr, Elf32_Addr verdef_addr,
 					Elf32_Addr verneed_addr, Elf32_Addr versym_addr, bool match_endian) {
     Elf_Symndx *hash = reinterpret_cast<Elf_Symndx *> (mem + hash_addr);
     
     this->match_endian = match_endian;
 
-    nbuckets =  *hash++;
-    nchain = *hash++;
-    buckets = static_cast<Elf_Symndx *>(hash);
-    hash += nbuckets;
-    chain = static_cast<Elf_Symndx *>(hash);
+    if (gnu_hash_addr != 0) /* Prefer the GNU hash table */
+      {
+	Elf32_Word *gnu = reinterpret_cast<Elf32_Word *> (mem + gnu_hash_addr);
+
+	has_gnu_hash = true;
+	nbuckets = read_word(gnu++);
+	gnu_symoffset = read_word(gnu++);
+	gnu_bloom_size = read_word(gnu++);
+	gnu_bloom_shift = read_word(gnu++);
+	gnu_bloom = gnu;
+	gnu += gnu_bloom_size;
+	buckets = static_cast<Elf_Symndx *>(gnu);
+	gnu += nbuckets;
+	chain = static_cast<Elf_Symndx *>(gnu);
+
+	if (hash_addr != 0)
+	  nchain = read_word(hash + 1);
+	else
+	  nchain = count_gnu_symbols();
+      }
+    else
+      {
+	nbuckets = read_word(hash++);
+	nchain = read_word(hash++);
+	buckets = static_cast<Elf_Symndx *>(hash);
+	hash += nbuckets;
+	chain = static_cast<Elf_Symndx *>(hash);
+      }
     
     symtab = reinterpret_cast<Elf32_Sym *> (mem + symtab_addr);
     strtab = static_cast<unsigned char *> (mem + strtab_addr);
@@ -190,7 +249,10 @@ namespace ac_dynlink {
       versym = reinterpret_cast<Elf_Verndx *> (mem + versym_addr);
   }
   
-  Elf32_Sym *dynamic_symbol_table::lookup_symbol(unsigned int hash, unsigned char *name,
+  /* Looks a symbol up. hash and gnuhash are its elf_hash() and
+     gnu_hash() values, only the one of the table in use is read. */
+  Elf32_Sym *dynamic_symbol_table::lookup_symbol(unsigned int hash, unsigned int gnuhash,
+						 unsigned char *name,
 						 char *vername, Elf32_Word verhash) {
     Elf_Symndx symndx;
     Elf32_Sym *symbol = NULL;
@@ -199,13 +261,43 @@ namespace ac_dynlink {
     last_match = NULL;
     is_unique_match = true;
     
-    for ( symndx = buckets[hash % nbuckets];
-	  symndx != STN_UNDEF;
-	  symndx = chain[symndx] ) {
-      symbol = check_symbol(symndx, name, vername, verhash);
-      if (symbol != NULL)
-	return symbol;
-    }
+    if (has_gnu_hash)
+      {
+	Elf32_Word bloom_word, mask, chain_hash;
+
+	/* The bloom filter has two bits set for every symbol in the
+	   table. If either one is clear, the symbol is not here. */
+	bloom_word = read_word(&gnu_bloom[(gnuhash / 32) % gnu_bloom_size]);
+	mask = (1U << (gnuhash % 32)) |
+	  (1U << ((gnuhash >> gnu_bloom_shift) % 32));
+	if ((bloom_word & mask) != mask)
+	  return NULL;
+
+	symndx = read_word(&buckets[gnuhash % nbuckets]);
+	if (symndx == STN_UNDEF)
+	  return NULL;
+
+	/* The chain ends at the hash value with the lowest bit set */
+	do {
+	  chain_hash = read_word(&chain[symndx - gnu_symoffset]);
+	  if ((chain_hash | 1) == (gnuhash | 1)) {
+	    symbol = check_symbol(symndx, name, vername, verhash);
+	    if (symbol != NULL)
+	      return symbol;
+	  }
+	  symndx++;
+	} while ((chain_hash & 1) == 0);
+      }
+    else
+      {
+	for ( symndx = read_word(&buckets[hash % nbuckets]);
+	      symndx != STN_UNDEF;
+	      symndx = read_word(&chain[symndx]) ) {
+	  symbol = check_symbol(symndx, name, vername, verhash);
+	  if (symbol != NULL)
+	    return symbol;
+	}
+      }
     
     if (last_match != NULL &&
 	is_unique_match)
@@ -66,6 +66,7 @@ namespace ac_dynlink {
     mem = NULL;
     sched_copy = NULL;
     _rtld_global_patched = false;
+    lazy_base = 0;
     this->rtld_config = rtld_config;
   }
 
@@ -209,16 +210,17 @@ namespace ac_dynlink {
     return soname; 
   }
 
-  Elf32_Sym *link_node::lookup_local_symbol(unsigned int hash, unsigned char *name,
+  Elf32_Sym *link_node::lookup_local_symbol(unsigned int hash, unsigned int gnuhash,
+					    unsigned char *name,
 					    char *vername, Elf32_Word verhash) 
   { 
-    return dyn_table.lookup_symbol(hash, name, vername, verhash);
+    return dyn_table.lookup_symbol(hash, gnuhash, name, vername, verhash);
   }
 
   bool link_node::link_node_setup(Elf32_Addr dynaddr, unsigned char *mem,
 				  Elf32_Addr l_addr, unsigned int t, unsigned char *name,
 				  version_needed *verneed, bool match_endian) {
-    Elf32_Addr hashaddr = 0, symaddr= 0, straddr = 0, reladdr = 0,
+    Elf32_Addr hashaddr = 0, gnuhashaddr = 0, symaddr= 0, straddr = 0, reladdr = 0,
       verneed_addr = 0, verdef_addr = 0, versym_addr = 0, init_addr = 0,
       init_addr_array = 0, init_addr_arraysz = 0, fini_addr = 0,
       fini_addr_array = 0, fini_addr_arraysz = 0;
@@ -236,6 +238,7 @@ namespace ac_dynlink {
     dyn_info.load_dynamic_info(dynaddr, mem, match_endian);
     
     hashaddr = dyn_info.get_value(DT_HASH);
+    gnuhashaddr = dyn_info.get_value(DT_GNU_HASH);
     symaddr = dyn_info.get_value(DT_SYMTAB);
     straddr = dyn_info.get_value(DT_STRTAB);
     verneed_addr = dyn_info.get_value(DT_VERNEED);
@@ -255,6 +258,8 @@ namespace ac_dynlink {
     
     if (hashaddr) 
       hashaddr += l_addr;
+    if (gnuhashaddr) 
+      gnuhashaddr += l_addr;
     if (symaddr) 
       symaddr += l_addr;
     if (straddr) 
@@ -301,7 +306,7 @@ namespace ac_dynlink {
        extracting needed libraries names. */
     dyn_info.set_value(DT_STRTAB, straddr);
     
-    dyn_table.setup_hash(mem, hashaddr, symaddr, straddr, verdef_addr,
+    dyn_table.setup_hash(mem, hashaddr, gnuhashaddr, symaddr, straddr, verdef_addr,
 			 verneed_addr, versym_addr, match_endian);
     
     pltrel = dyn_info.get_value(DT_PLTREL);
@@ -455,21 +460,32 @@ namespace ac_dynlink {
   /* Finds a defined version of the symbol looking through 
      all loaded libraries. If exclude_root is true, skips
      root file symbols when looking for the symbol.
+     Answers are remembered by the root node, so every
+     (name, version) pair is looked up only once.
    */
   Elf32_Sym * link_node::find_symbol(unsigned char *name, char *vername, Elf32_Word verhash, 
                                      bool exclude_root)
   {
     link_node *p = root;
-    unsigned int symhash = dyn_table.elf_hash(name);
+    unsigned int symhash, gnuhash;
     Elf32_Sym *the_symbol = NULL, *weak_sym = NULL;
     symbol_wrapper *symbol;
+    symbol_cache_map &cache = root->symbol_cache[exclude_root];
+    std::pair<std::string, std::string> key((char *)name, vername? vername : "");
+    symbol_cache_map::iterator cached = cache.find(key);
+
+    if (cached != cache.end())
+      return cached->second;
+
+    symhash = dyn_table.elf_hash(name);
+    gnuhash = dyn_table.gnu_hash(name);
 
     if (exclude_root == true)
       p = p->get_next();
     
     while (p != NULL)
       {
-	the_symbol = p->lookup_local_symbol(symhash, name, vername, verhash);
+	the_symbol = p->lookup_local_symbol(symhash, gnuhash, name, vername, verhash);
         if (the_symbol != NULL) {
           symbol = new symbol_wrapper(the_symbol, match_endian);
           if (ELF32_ST_BIND(symbol->read_info()) == STB_WEAK) {
@@ -497,104 +513,115 @@ namespace ac_dynlink {
 
     
     if (the_symbol == NULL && weak_sym != NULL)
-      return weak_sym;
+      the_symbol = weak_sym;
+    cache[key] = the_symbol;
     return the_symbol;
   }
   
-  /* Walks through object's relocations, finds out if the symbol
-     is undefined. If it is, Look up for its definition in other
-     nodes */
-  void link_node::resolve_symbols() 
+#define FETCH_RELOC_TYPE(a,b)                                              \
+        if (rtld_config != NULL) {                                         \
+          if (rtld_config->translate(ELF32_R_TYPE(a), &b)==-1)             \
+            {                                                              \
+              b = ELF32_R_TYPE(a);                                         \
+            }                                                              \
+        } else {                                                           \
+          b = ELF32_R_TYPE(a);                                             \
+        }
+
+  /* If the symbol is undefined, looks up for its definition in
+     other nodes and copies it over. */
+  void link_node::resolve_symbol(Elf_Symndx symndx)
   {
-    unsigned int i;
-    Elf32_Word info, verhash;
-    Elf_Symndx symndx;
-    Elf32_Sym *elf_symbol, *def_elf_symbol;
+    Elf32_Word verhash;
+    Elf32_Sym *def_elf_symbol;
     symbol_wrapper *symbol, *def_symbol;
     char *vername;
     unsigned char symbol_info = 0, weak = 0;
-    
-    if (!has_relocations)
-      return;
-    
-    for (i = 0;
-	 i < dyn_relocs.get_size();
-	 i++) 
-      {
-	info = dyn_relocs.read_info(i);
-	symndx = ELF32_R_SYM(info);
-	elf_symbol = dyn_table.get_symbol(symndx);
-	symbol = new symbol_wrapper(elf_symbol, match_endian);
-	symbol_info = symbol->read_info();
+
+    symbol = new symbol_wrapper(dyn_table.get_symbol(symndx), match_endian);
+    symbol_info = symbol->read_info();
 	
-	if (ELF32_ST_TYPE(symbol_info) > STT_FUNC &&
-	    ELF32_ST_TYPE(symbol_info) != STT_COMMON) {
-	  delete symbol;
-	  continue; /* Not a symbol type we need to resolve */
-	}
+    if (ELF32_ST_TYPE(symbol_info) > STT_FUNC &&
+	ELF32_ST_TYPE(symbol_info) != STT_COMMON) {
+      delete symbol;
+      return; /* Not a symbol type we need to resolve */
+    }
 	
-	if (ELF32_ST_BIND(symbol_info) == STB_LOCAL ||
-	    ELF32_ST_BIND(symbol_info) > STB_WEAK) {
-	  delete symbol;
-	  continue; /* Not global or weak */
-	}
+    if (ELF32_ST_BIND(symbol_info) == STB_LOCAL ||
+	ELF32_ST_BIND(symbol_info) > STB_WEAK) {
+      delete symbol;
+      return; /* Not global or weak */
+    }
 	
-	if (ELF32_ST_BIND(symbol_info) == STB_WEAK) {
-	  weak = 1;
-	}
+    if (ELF32_ST_BIND(symbol_info) == STB_WEAK) {
+      weak = 1;
+    }
 	
-	if (symbol->read_section_ndx() != SHN_UNDEF) {
-	    delete symbol;
-	    continue;  /* Symbol is not undefined, no need to resolve */
-	}
+    if (symbol->read_section_ndx() != SHN_UNDEF) {
+      delete symbol;
+      return;  /* Symbol is not undefined, no need to resolve */
+    }
 	
-	vername = NULL;
-	verhash = 0;
-	/* Are we requesting a special version? */
-	if (dyn_table.get_verneed() != NULL)
-	  {
-	    Elf32_Half verndx = dyn_table.get_verndx(symndx);
-	    vername = dyn_table.get_verneed()->lookup_version(verndx & 0x7fff);
-	    verhash = dyn_table.get_verneed()->get_cur_hash();
-	  }
+    vername = NULL;
+    verhash = 0;
+    /* Are we requesting a special version? */
+    if (dyn_table.get_verneed() != NULL)
+      {
+	Elf32_Half verndx = dyn_table.get_verndx(symndx);
+	vername = dyn_table.get_verneed()->lookup_version(verndx & 0x7fff);
+	verhash = dyn_table.get_verneed()->get_cur_hash();
+      }
 	
-	def_elf_symbol = NULL;
-        def_elf_symbol = find_symbol(dyn_table.get_name(symbol->read_name_ndx()), vername, verhash, false);
+    def_elf_symbol = NULL;
+    def_elf_symbol = find_symbol(dyn_table.get_name(symbol->read_name_ndx()), vername, verhash, false);
 	
-	if (def_elf_symbol == NULL)  /* Symbol not found. */
-	  {
-	    if (weak) {
-	      delete symbol;
-	      continue; /* Definition for this symbol is not a problem */	      
-	    }
-	    AC_ERROR("Run-time dynamic linker: Symbol \"" << 
-		     dyn_table.get_name(symbol->read_name_ndx()) << "\" unknown.");
-	    exit(EXIT_FAILURE);
-	  }
+    if (def_elf_symbol == NULL)  /* Symbol not found. */
+      {
+	if (weak) {
+	  delete symbol;
+	  return; /* Definition for this symbol is not a problem */	      
+	}
+	AC_ERROR("Run-time dynamic linker: Symbol \"" << 
+		 dyn_table.get_name(symbol->read_name_ndx()) << "\" unknown.");
+	exit(EXIT_FAILURE);
+      }
 	
-	/* Symbol found */
-	def_symbol = new symbol_wrapper(def_elf_symbol, match_endian);
-	symbol->write_value(def_symbol->read_value());
-	symbol->write_size(def_symbol->read_size());
-	symbol->write_section_ndx(def_symbol->read_section_ndx());
-	symbol->write_info(def_symbol->read_info());
+    /* Symbol found */
+    def_symbol = new symbol_wrapper(def_elf_symbol, match_endian);
+    symbol->write_value(def_symbol->read_value());
+    symbol->write_size(def_symbol->read_size());
+    symbol->write_section_ndx(def_symbol->read_section_ndx());
+    symbol->write_info(def_symbol->read_info());
 	
-	/* Done */
-	delete def_symbol;
-	delete symbol;
+    /* Done */
+    delete def_symbol;
+    delete symbol;
+  } /* resolve_symbol() */
+
+  /* Walks through object's relocations, finds out if the symbol
+     is undefined. If it is, Look up for its definition in other
+     nodes. With lazy binding, symbols used only by JUMP_SLOT
+     relocations are left for bind_jump_slot(). */
+  void link_node::resolve_symbols() 
+  {
+    unsigned int i, reloc_type;
+    Elf32_Word info;
+    
+    if (!has_relocations)
+      return;
+    
+    for (i = 0;
+	 i < dyn_relocs.get_size();
+	 i++) 
+      {
+	info = dyn_relocs.read_info(i);
+        FETCH_RELOC_TYPE(info, reloc_type);
+        if (root->lazy_base != 0 && reloc_type == 3) /* JUMP_SLOT */
+          continue;
+	resolve_symbol(ELF32_R_SYM(info));
       } /* for(i=0;i<dyn_relocs.get_size();i++) */
   } /* resolve_symbols() */
 
-#define FETCH_RELOC_TYPE(a,b)                                              \
-        if (rtld_config != NULL) {                                         \
-          if (rtld_config->translate(ELF32_R_TYPE(a), &b)==-1)             \
-            {                                                              \
-              b = ELF32_R_TYPE(a);                                         \
-            }                                                              \
-        } else {                                                           \
-          b = ELF32_R_TYPE(a);                                             \
-        }
-
   Elf32_Addr link_node::find_copy_relocation(unsigned char *symname)
   {
     unsigned int i;
@@ -658,6 +685,7 @@ namespace ac_dynlink {
     Elf32_Sym *elf_symbol;
     symbol_wrapper *symbol;
     Elf32_Word symsize;
+    bool unresolved;
     
     if (!has_relocations)
       return;
@@ -674,6 +702,7 @@ namespace ac_dynlink {
 	symbol = new symbol_wrapper(elf_symbol, match_endian);
 	target = symbol->read_value();
 	symsize = symbol->read_size();
+	unresolved = (symndx != STN_UNDEF && symbol->read_section_ndx() == SHN_UNDEF);
 	delete symbol;
 	target += dyn_relocs.read_addend(i);
 	location = dyn_relocs.read_offset(i);
@@ -703,11 +732,19 @@ namespace ac_dynlink {
             target_size = 8;
             patch_code(mem+location, target, target_size);
             break;
+	  case 3: /* JUMP_SLOT */
+	    if (unresolved && root->lazy_base != 0) {
+	      /* Point the slot to its trap address. The symbol is
+		 bound on the first call, by bind_jump_slot(). */
+	      patch_code(mem+location, root->add_lazy_slot(this, i), target_size);
+	      break;
+	    }
+            patch_code(mem+location, target, target_size);
+	    break;
 	  case 6: /* ABS16 */
             target_size = 16;
             /* Fall through */
           case 7: /* ABS32 */
-	  case 3: /* JUMP_SLOT */
 	  case 4: /* GLOB_DAT */
             patch_code(mem+location, target, target_size);
 	    break;
@@ -739,4 +776,102 @@ namespace ac_dynlink {
       } /* for(i=0;i<dyn_relocs.get_size();i++) */
   } /* apply_relocations() */
 
+  /* Counts the JUMP_SLOT relocations, the PLT slots that lazy
+     binding may leave unbound. */
+  unsigned int link_node::count_jump_slots()
+  {
+    unsigned int i, reloc_type, n = 0;
+
+    if (!has_relocations)
+      return 0;
+
+    for (i = 0; i < dyn_relocs.get_size(); i++) {
+      FETCH_RELOC_TYPE(dyn_relocs.read_info(i), reloc_type);
+      if (reloc_type == 3) /* JUMP_SLOT */
+        n++;
+    }
+    return n;
+  }
+
+  /* Enables lazy binding: PLT slots get trap addresses from base
+     on, LAZY_SLOT_SIZE bytes apart. */
+  void link_node::set_lazy_base(Elf32_Addr base)
+  {
+    if (root == NULL || root == this) {
+      lazy_base = base;
+      return;
+    }
+    root->set_lazy_base(base);
+  }
+
+  /* Registers an unbound PLT slot and returns its trap address */
+  Elf32_Addr link_node::add_lazy_slot(link_node *node, unsigned int reloc)
+  {
+    if (root == NULL || root == this) {
+      lazy_slot slot;
+      slot.node = node;
+      slot.reloc = reloc;
+      lazy_slots.push_back(slot);
+      return lazy_base + (lazy_slots.size() - 1) * LAZY_SLOT_SIZE;
+    }
+    return root->add_lazy_slot(node, reloc);
+  }
+
+  /* Number of PLT slots left for lazy binding */
+  unsigned int link_node::get_lazy_slot_n()
+  {
+    if (root == NULL || root == this)
+      return lazy_slots.size();
+    return root->get_lazy_slot_n();
+  }
+
+  /* Index of the JUMP_SLOT relocation of lazy slot n */
+  unsigned int link_node::get_lazy_slot_reloc(unsigned int n)
+  {
+    if (root == NULL || root == this)
+      return lazy_slots[n].reloc;
+    return root->get_lazy_slot_reloc(n);
+  }
+
+  /* The simulator reached a trap address: binds the slot it
+     belongs to and returns the function address. */
+  Elf32_Addr link_node::bind_lazy_slot(Elf32_Addr trap, unsigned char word_size)
+  {
+    unsigned int n;
+
+    if (root != NULL && root != this)
+      return root->bind_lazy_slot(trap, word_size);
+
+    n = (trap - lazy_base) / LAZY_SLOT_SIZE;
+    if (trap < lazy_base || n >= lazy_slots.size()) {
+      AC_ERROR("Run-time dynamic linker: no PLT slot for trap address " 
+               << std::hex << trap << std::dec << ".");
+      exit(EXIT_FAILURE);
+    }
+    return lazy_slots[n].node->bind_jump_slot(lazy_slots[n].reloc, word_size);
+  }
+
+  /* Resolves the symbol of a JUMP_SLOT relocation left by lazy
+     binding and patches the slot, so the next calls go straight
+     to the function. Returns the function address. */
+  Elf32_Addr link_node::bind_jump_slot(unsigned int reloc, unsigned char word_size)
+  {
+    Elf32_Word info = dyn_relocs.read_info(reloc);
+    Elf_Symndx symndx = ELF32_R_SYM(info);
+    Elf32_Addr target, location;
+    symbol_wrapper *symbol;
+
+    resolve_symbol(symndx);
+
+    symbol = new symbol_wrapper(dyn_table.get_symbol(symndx), match_endian);
+    target = symbol->read_value();
+    delete symbol;
+    target += dyn_relocs.read_addend(reloc);
+    location = dyn_relocs.read_offset(reloc);
+    location += load_addr;
+
+    patch_code(mem+location, target, word_size);
+    return target;
+  }
+
 }
@@ -40,112 +40,239 @@
 #include <unistd.h>
 
 #include "memmap.H"
+#include "ac_checkpoint.H"
 
 //#define DEBUG_MEMORY
 
 namespace ac_dynlink {
 
+#define ALIGN_ADDR(align) ((align) - ((align) % pagesize) + pagesize)
+#define LAST_ADDR ((Elf32_Addr) -1)
+
   /*
      memmap_node class methods
    */
   /* 
      Default constructor
    */
-  memmap_node::memmap_node(memmap_node * _next, memmap_status _status, Elf32_Addr _addr):
-    next(_next),
+  memmap_node::memmap_node(memmap_status _status, Elf32_Addr _addr, Elf32_Addr _last):
+    left(NULL),
+    right(NULL),
+    addr(_addr),
+    last(_last),
     status(_status),
-    addr(_addr) {
-  }
-    
-  memmap_node* memmap_node::get_next() {
-    return next;
+    height(1),
+    room(0),
+    max_room(0) {
   }
     
   Elf32_Addr memmap_node::get_addr() {
     return addr;
   }
     
+  Elf32_Addr memmap_node::get_last() {
+    return last;
+  }
+    
   memmap_status memmap_node::get_status() {
     return status;
   }
-
-  void memmap_node::set_status(memmap_status value) {
-    status = value;
-  }
-
-  void memmap_node::set_next(memmap_node *next) {
-    this->next = next;
-  }
    
   /*
      memmap class methods
    */
-  void memmap::delete_node(memmap_node *node) {
-    memmap_node *aux = list, *prior = NULL;
-    
-    while (aux != NULL && aux != node){
-      prior = aux;
-      aux = aux->get_next();
+
+  /* AVL tree of regions, ordered by address */
+
+  int memmap::height(memmap_node *t) {
+    return t == NULL ? 0 : t->height;
+  }
+
+  /* Recomputes the height and rooms of a node from its children. The
+     room of a free region starts where mmap would put a block in it,
+     ALIGN_ADDR(addr). */
+  void memmap::update(memmap_node *t) {
+    Elf32_Addr start = ALIGN_ADDR(t->addr);
+
+    t->height = 1 + (height(t->left) > height(t->right) ?
+                     height(t->left) : height(t->right));
+    t->room = 0;
+    if (t->status == MS_FREE && start > t->addr && start <= t->last)
+      t->room = t->last - start + 1;
+    t->max_room = t->room;
+    if (t->left != NULL && t->left->max_room > t->max_room)
+      t->max_room = t->left->max_room;
+    if (t->right != NULL && t->right->max_room > t->max_room)
+      t->max_room = t->right->max_room;
+  }
+
+  memmap_node *memmap::rotate_left(memmap_node *t) {
+    memmap_node *r = t->right;
+
+    t->right = r->left;
+    r->left = t;
+    update(t);
+    update(r);
+    return r;
+  }
+
+  memmap_node *memmap::rotate_right(memmap_node *t) {
+    memmap_node *l = t->left;
+
+    t->left = l->right;
+    l->right = t;
+    update(t);
+    update(l);
+    return l;
+  }
+
+  memmap_node *memmap::balance(memmap_node *t) {
+    update(t);
+    if (height(t->left) > height(t->right) + 1) {
+      if (height(t->left->left) < height(t->left->right))
+        t->left = rotate_left(t->left);
+      return rotate_right(t);
     }
-    if (node == list) {
-      aux = list->get_next();
-      delete list;
-      list = aux;
-    } else {
-      memmap_node *aux2 = aux->get_next();
-      delete aux;
-      prior->set_next(aux2);
+    if (height(t->right) > height(t->left) + 1) {
+      if (height(t->right->right) < height(t->right->left))
+        t->right = rotate_right(t->right);
+      return rotate_left(t);
     }
+    return t;
   }
 
-  void memmap::fix_consistency() {
-    memmap_node *aux = list->get_next(), *prior=list;
-    
-    /* fixes misplaced nodes */
-    while (aux != NULL) {
-      if (aux->get_addr() <= prior->get_addr() &&
-	  !(aux->get_status() == MS_FREE &&
-	    prior->get_status() == MS_FREE)) {
-	if (prior == list) {
-	  list = aux;
-          delete prior;
-        } else
-          delete_node(prior);
-      }
-      prior = aux;
-      aux = aux->get_next();
+  memmap_node *memmap::insert(memmap_node *t, memmap_node *node) {
+    if (t == NULL) {
+      update(node);
+      return node;
     }
-    
-    /* merges contigous free block regions */
-    aux = list->get_next();
-    prior = list;
-    while (aux != NULL) {
-      if (aux->get_status() == MS_FREE &&
-	  prior->get_status() == MS_FREE) {
-	aux = aux->get_next();
-	delete_node(prior->get_next());
-      } else {
-	prior = aux;
-	aux = aux->get_next();
-      }
-    }    
+    if (node->addr < t->addr)
+      t->left = insert(t->left, node);
+    else
+      t->right = insert(t->right, node);
+    return balance(t);
+  }
+
+  /* Detaches the lowest node of a subtree */
+  memmap_node *memmap::remove_min(memmap_node *t, memmap_node **min) {
+    if (t->left == NULL) {
+      *min = t;
+      return t->right;
+    }
+    t->left = remove_min(t->left, min);
+    return balance(t);
+  }
+
+  /* Deletes the region starting at addr. Other nodes are relinked,
+     never copied, so pointers to them stay valid. */
+  memmap_node *memmap::remove(memmap_node *t, Elf32_Addr addr) {
+    memmap_node *l, *r, *min;
+
+    if (t == NULL)
+      return NULL;
+    if (addr < t->addr)
+      t->left = remove(t->left, addr);
+    else if (addr > t->addr)
+      t->right = remove(t->right, addr);
+    else {
+      l = t->left;
+      r = t->right;
+      delete t;
+      if (r == NULL)
+        return l;
+      r = remove_min(r, &min);
+      min->left = l;
+      min->right = r;
+      return balance(min);
+    }
+    return balance(t);
+  }
+
+  /* Updates the nodes from t down to the region starting at addr,
+     after that region changed. */
+  memmap_node *memmap::touch(memmap_node *t, Elf32_Addr addr) {
+    if (t == NULL)
+      return NULL;
+    if (addr < t->addr)
+      touch(t->left, addr);
+    else if (addr > t->addr)
+      touch(t->right, addr);
+    update(t);
+    return t;
+  }
+
+  /* Region holding addr. There is always one, as the regions cover
+     the whole address space. */
+  memmap_node *memmap::containing(Elf32_Addr addr) {
+    memmap_node *t = root, *found = NULL;
+
+    while (t != NULL) {
+      if (t->addr <= addr) {
+        found = t;
+        t = t->right;
+      } else
+        t = t->left;
+    }
+    return found;
   }
 
-  void memmap::free_memmap() {
-    memmap_node *aux = list;
-    if (list == NULL)
+  /* Lowest region starting at addr or above */
+  memmap_node *memmap::lower_bound(Elf32_Addr addr) {
+    memmap_node *t = root, *found = NULL;
+
+    while (t != NULL) {
+      if (t->addr >= addr) {
+        found = t;
+        t = t->left;
+      } else
+        t = t->right;
+    }
+    return found;
+  }
+
+  /* Lowest free region starting above addr with room for size
+     bytes. Subtrees without such a room are skipped whole. */
+  memmap_node *memmap::first_room(memmap_node *t, Elf32_Addr addr, Elf32_Word size) {
+    memmap_node *found;
+
+    if (t == NULL || t->max_room < size)
+      return NULL;
+    if (t->addr > addr) {
+      found = first_room(t->left, addr, size);
+      if (found != NULL)
+        return found;
+      if (t->room >= size)
+        return t;
+    }
+    return first_room(t->right, addr, size);
+  }
+
+  /* Makes addr the start of a region, splitting the one holding it */
+  void memmap::split(Elf32_Addr addr) {
+    memmap_node *aux = containing(addr);
+
+    if (aux->addr == addr)
+      return;
+    root = insert(root, new memmap_node(aux->status, addr, aux->last));
+    aux->last = addr - 1;
+    root = touch(root, aux->addr);
+  }
+
+  void memmap::free_memmap(memmap_node *t) {
+    if (t == NULL)
       return;
-    list = list->get_next();
-    delete aux;
-    free_memmap();
+    free_memmap(t->left);
+    free_memmap(t->right);
+    delete t;
   }
 
   /* 
      Default constructor
    */
   memmap::memmap() {
-      list = new memmap_node(NULL, MS_FREE, 0);
       pagesize = sysconf(_SC_PAGE_SIZE);
+      root = NULL;
+      root = insert(root, new memmap_node(MS_FREE, 0, LAST_ADDR));
       brkaddr = 0;
       newbrkaddr = 0;
       memsize = 0;
@@ -156,7 +283,7 @@ namespace ac_dynlink {
      Default destructor
    */
   memmap::~memmap() {
-    free_memmap();
+    free_memmap(root);
   }
 
   void memmap::set_memsize(Elf32_Addr memsize) {
@@ -170,45 +297,44 @@ namespace ac_dynlink {
   }
 
   memmap_node *memmap::find_region (Elf32_Addr addr) {
-    memmap_node *aux = list;
+    memmap_node *aux = containing(addr);
     
-    while (aux != NULL) {
-      if (aux->get_addr() == addr)
-	break;
-      aux = aux->get_next();
-    }
+    if (aux->addr != addr)
+      return NULL;
     return aux;
   }
 
   memmap_node *memmap::add_region (Elf32_Addr start_addr, Elf32_Word size) {
-    memmap_node *aux = list, *prior = NULL;
+    memmap_node *aux;
+    Elf32_Addr last = start_addr + size - 1;
 
     if (start_addr + ((unsigned)size) > memsize) {
       fprintf(stderr, "ArchC memory manager error: not enough memory in target.\n");
       exit(EXIT_FAILURE);
     }
+
+    if (size == 0)
+      return find_region(start_addr);
     
-    while (aux != NULL && aux->get_addr() < start_addr) {
-      prior = aux;
-      aux = aux->get_next();
-    }
-    
-    if (prior == NULL) {
-      prior = aux;
-      aux = aux->get_next();
-    }
-    
-    prior->set_next(new memmap_node(new memmap_node(aux, MS_FREE, start_addr+size), MS_USED, start_addr));
-    fix_consistency();
+    split(start_addr);
+    if (last != LAST_ADDR)
+      split(last + 1);
+
+    /* Regions inside the new one are absorbed by it */
+    while ((aux = lower_bound(start_addr + 1)) != NULL && aux->addr <= last)
+      root = remove(root, aux->addr);
+
+    aux = find_region(start_addr);
+    aux->status = MS_USED;
+    aux->last = last;
+    root = touch(root, start_addr);
     
-    return find_region(start_addr);
+    return aux;
   }
 
-#define ALIGN_ADDR(align) ((align) - ((align) % pagesize) + pagesize)
-
   bool memmap::verify_region_availability(Elf32_Addr addr, Elf32_Word size, Elf32_Addr *next_addr)
   {
-    memmap_node *aux = list;
+    memmap_node *aux, *next;
 
     if (addr <= ALIGN_ADDR(newbrkaddr)) {
       if (next_addr != NULL)
@@ -217,22 +343,19 @@ namespace ac_dynlink {
     }
 
     /* Finds the highest region address which is also lower or equal addr*/
-    while (aux->get_next() != NULL) {
-      if (aux->get_next()->get_addr() > addr)
-        break;
-      aux = aux->get_next();
-    }
+    aux = containing(addr);
+    next = (aux->last == LAST_ADDR) ? NULL : lower_bound(aux->last + 1);
     if (next_addr != NULL)
       *next_addr = 0;
-    if (aux->get_status() == MS_USED) {
-      if (next_addr != NULL && aux->get_next() != NULL)
-        *next_addr = aux->get_next()->get_addr();
+    if (aux->status == MS_USED) {
+      if (next_addr != NULL && next != NULL)
+        *next_addr = next->addr;
       return false; //  this region is occupied
-    } else if (aux->get_next() != NULL &&
-               aux->get_next()->get_status() == MS_USED) {
-      if (addr + ((unsigned)size) > aux->get_next()->get_addr()) {
-        if (next_addr != NULL && aux->get_next()->get_next() != NULL)
-          *next_addr = aux->get_next()->get_next()->get_addr();
+    } else if (next != NULL &&
+               next->status == MS_USED) {
+      if (addr + ((unsigned)size) > next->addr) {
+        if (next_addr != NULL && next->last != LAST_ADDR)
+          *next_addr = next->last + 1;
         return false; // not enough space
       }
     }
@@ -240,39 +363,44 @@ namespace ac_dynlink {
   }
   
   Elf32_Addr memmap::suggest_free_region (Elf32_Word size) {
-    memmap_node *aux = list;
-
-    while (aux->get_next() != NULL)
-      aux = aux->get_next();
+    memmap_node *aux = containing(LAST_ADDR);
 
-    if ((aux->get_addr() % pagesize) == 0)
-      return aux->get_addr();
+    if ((aux->addr % pagesize) == 0)
+      return aux->addr;
     else {
-      return ALIGN_ADDR(aux->get_addr());
+      return ALIGN_ADDR(aux->addr);
     }
   }
 
+  /* First address from addr on where mmap may put size bytes: addr
+     itself, or the start of the first free region after it with
+     enough room. Returns -1 if there is none below memsize. */
+  Elf32_Addr memmap::find_mmap_region(Elf32_Addr addr, Elf32_Word size) {
+    memmap_node *aux;
+
+    if (addr <= ALIGN_ADDR(newbrkaddr))
+      addr = ALIGN_ADDR(ALIGN_ADDR(newbrkaddr));
+    if (addr + ((unsigned)size) < memsize &&
+        verify_region_availability(addr, size, NULL))
+      return addr;
+
+    aux = first_room(root, addr, size);
+    if (aux == NULL || ALIGN_ADDR(aux->addr) + ((unsigned)size) >= memsize)
+      return (Elf32_Addr) -1;
+    return ALIGN_ADDR(aux->addr);
+  }
+
   Elf32_Addr memmap::suggest_mmap_region(Elf32_Word size) {
     /* Better suggest region far from stack and far from program break */
     Elf32_Addr addr = ((memsize - newbrkaddr) >> 1) + newbrkaddr;
-    Elf32_Addr nextaddr;
-    bool loop = false;
     addr = ALIGN_ADDR(addr);
 
-    /* Verify availability */
-    while (!verify_region_availability(addr, size, &nextaddr)) {
-      if (nextaddr != 0 && nextaddr + ((unsigned)size) < memsize)
-        addr = ALIGN_ADDR(nextaddr);
-      else if (!loop) {
-        loop = true;
-        addr = ALIGN_ADDR(brkaddr);
-      } else {
-        if (warning_display) {
-          fprintf(stderr, "ArchC memory manager warning: target ran out of memory - mmap call failed.\n");
-          warning_display = false;
-        }
-        return (Elf32_Addr)-1;
-      }
+    addr = find_mmap_region(addr, size);
+    if (addr == (Elf32_Addr) -1)
+      addr = find_mmap_region(ALIGN_ADDR(brkaddr), size);
+    if (addr == (Elf32_Addr) -1 && warning_display) {
+      fprintf(stderr, "ArchC memory manager warning: target ran out of memory - mmap call failed.\n");
+      warning_display = false;
     }
     return addr;
   }
@@ -306,7 +434,7 @@ namespace ac_dynlink {
   }
 
   bool memmap::munmap(Elf32_Addr addr, Elf32_Word size) {
-    memmap_node* aux;
+    memmap_node *aux, *next, *prior;
     if (addr == 0)
       return false;
     if (addr % pagesize != 0)
@@ -314,11 +442,23 @@ namespace ac_dynlink {
     aux = find_region (addr);
     if (aux == NULL)
       return false;
-    if (aux->get_next() != NULL) {
-      if (aux->get_next()->get_addr() - aux->get_addr() <= size)
+    if (aux->last != LAST_ADDR) {
+      if (aux->last - aux->addr + 1 <= size)
         {
-          aux->set_status(MS_FREE);
-          fix_consistency();
+          /* Free it and merge it with the free regions around it */
+          aux->status = MS_FREE;
+          next = lower_bound(aux->last + 1);
+          if (next->status == MS_FREE) {
+            aux->last = next->last;
+            root = remove(root, next->addr);
+          }
+          root = touch(root, aux->addr);
+          prior = containing(aux->addr - 1);
+          if (prior->status == MS_FREE) {
+            prior->last = aux->last;
+            root = remove(root, aux->addr);
+            root = touch(root, prior->addr);
+          }
         }
     }
 #ifdef DEBUG_MEMORY
@@ -328,7 +468,7 @@ namespace ac_dynlink {
   }
 
   Elf32_Addr memmap::brk(Elf32_Addr addr) {
-    memmap_node *aux = list;
+    memmap_node *aux;
 
     if (addr <= brkaddr)
       return newbrkaddr;
@@ -346,15 +486,15 @@ namespace ac_dynlink {
       return newbrkaddr;
     }
 
-    /* Finds the lowest used region address which is also higher or equal newbrkaddr*/
-    while (aux != NULL) {
-      if (aux->get_addr() >= newbrkaddr && aux->get_status() == MS_USED)
-        break;
-      aux = aux->get_next();
-    }
+    /* Finds the lowest used region address which is also higher or
+       equal newbrkaddr. Free regions are merged, so it is the first
+       region there or the next one. */
+    aux = lower_bound(newbrkaddr);
+    if (aux != NULL && aux->status == MS_FREE)
+      aux = (aux->last == LAST_ADDR) ? NULL : lower_bound(aux->last + 1);
 
     if (aux != NULL) { 
-      if (addr >= aux->get_addr())
+      if (addr >= aux->addr)
         return newbrkaddr;
     }
 
@@ -366,4 +506,47 @@ namespace ac_dynlink {
     return addr;
     
   }
+
+  /* Saves or restores the regions and the program break */
+  void memmap::checkpoint(ac_checkpoint& ck) {
+    unsigned count = 0;
+    memmap_node *aux;
+
+    ck.section("memmap");
+    ck.value(memsize);
+    ck.value(brkaddr);
+    ck.value(newbrkaddr);
+
+    if (ck.saving()) {
+      for (aux = containing(0); aux != NULL;
+           aux = (aux->last == LAST_ADDR) ? NULL : lower_bound(aux->last + 1))
+        count++;
+      ck.value(count);
+      for (aux = containing(0); aux != NULL;
+           aux = (aux->last == LAST_ADDR) ? NULL : lower_bound(aux->last + 1)) {
+        Elf32_Addr addr = aux->addr;
+        memmap_status status = aux->status;
+        ck.value(addr);
+        ck.value(status);
+      }
+      return;
+    }
+
+    free_memmap(root);
+    root = NULL;
+    ck.value(count);
+    aux = NULL;
+    while (count-- && ck.ok()) {
+      Elf32_Addr addr;
+      memmap_status status;
+      ck.value(addr);
+      ck.value(status);
+      if (aux != NULL) {
+        aux->last = addr - 1;
+        root = touch(root, aux->addr);
+      }
+      aux = new memmap_node(status, addr, LAST_ADDR);
+      root = insert(root, aux);
+    }
+  }
 }
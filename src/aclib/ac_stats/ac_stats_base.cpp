@@ -77,6 +77,15 @@ void ac_stats_base::print_all_stats(ostream& os)
   }
 }
 
+void ac_stats_base::collect_all_stats(vector<string>& names,
+    vector<long long>& values)
+{
+  list<ac_stats_base*>::iterator it;
+  for (it = list_of_stats_.begin(); it != list_of_stats_.end(); it++) {
+    (*it)->collect_stats(names, values);
+  }
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
 // Destructors
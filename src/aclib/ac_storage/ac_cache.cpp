@@ -32,8 +32,32 @@
  *
  */
 
+#include <string.h>
 #include "ac_cache.H"
 #include "ac_resources.H"
+#include "ac_sampler.H"
+
+const char* ac_cache_stat_list::statnames = "ACCESSES, MISSES, PF_ISSUED, PF_USEFUL, PF_LATE, PF_USELESS, PF_DROPPED";
+
+  ac_cache_stats::ac_cache_stats(const char* nm) :
+    ac_basic_stats<ac_cache_stat_list>(),
+    ac_stats_base(),
+    cache_name_(nm)
+  {}
+
+  void ac_cache_stats::print_stats(ostream& os)
+  {
+      os << "[ArchC 2.1] Printing statistics from cache "
+         << cache_name_ << ":" << std::endl;
+
+      for (int i = 0; i < number_of_stats_; i++)
+          os << "     " << stat_name_[i] << " : " << stat_[i] << std::endl;
+  }
+
+  void ac_cache_stats::collect_stats(vector<string>& names, vector<long long>& values)
+  {
+      collect(cache_name_, names, values);
+  }
 
 //!Private method for the generation of trace files to be utilized with DineroIV
   void ac_cache::tracing(unsigned address, unsigned type)
@@ -85,9 +109,20 @@
 //      	  cout << "Hit at TAG: " << *test_tag << endl;
       	}
       }
+      if(ac_sampler::measuring)
+      {
+         stats[ac_cache_stat_list::ACCESSES]++;
+         if(hit == -1)
+            stats[ac_cache_stat_list::MISSES]++;
+      }
       //Points to the correct mapped cache line
       if(hit!=-1) //Whether had got a hit.
       {
+         if(prefetched[hit + this->set * this->set_size])
+         {
+            stats[ac_cache_stat_list::PF_USEFUL]++;
+            prefetched[hit + this->set * this->set_size] = false;
+         }
          slot_data = (char *)(this->Data + (hit + this->set * this->set_size) *this->block_size * AC_WORDSIZE/8);
          slot_tag = (unsigned *)(this->tag + (hit + this->set * this->set_size));
          slot_valid = (bool *)(this->valid + (hit + this->set * this->set_size));
@@ -139,6 +174,7 @@
                         if(this->next_level != NULL)
                         {
 //                            cout << "address em replaceWrite: " << hex << base_address << endl;
+                            block_requests.push_back(-1);
                             this->next_level->request_block(this, base_address, block_size*AC_WORDSIZE/8);
                             break;
                         }
@@ -234,6 +270,7 @@
                  {
 //                       cout << "address_base em replaceRead: " << hex << base_address << "address: " << address << endl;
 //                       cout << "requested address: " << requested_address << endl;
+                       block_requests.push_back(-1);
                        this->next_level->request_block(this, base_address, block_size*AC_WORDSIZE/8);
                        break;
                  }
@@ -295,6 +332,12 @@
 //!Read a word from the address passed as parameter
   ac_word ac_cache::read( unsigned address ) /*const*/
   {
+      if(!ac_sampler::detailed)  //Fast-forwarding: the cache is bypassed
+      {
+         ac_word datum;
+         this->functional_read(address, (char*)&datum, sizeof(datum));
+         return (datum);
+      }
       read_access_type = true;
       ac_word data_out;                    //hold the requested Data
       this->ac_cache::addressing(address); //slicing the address field
@@ -311,20 +354,30 @@
 #ifdef AC_STATS
          ac_resources::ac_sim_stats.add_miss(name);
 #endif
-         this->stall();    //Stalls the processor, while the data is being provided
-//         replace_status = 0;
-         requested_address = address;
-         this->replaceBlockRead(requested_address); // imitando o write, original address
+         if(!this->waitMSHR(address))
+         {
+             this->stall();    //Stalls the processor, while the data is being provided
+//             replace_status = 0;
+             requested_address = address;
+             this->replaceBlockRead(requested_address); // imitando o write, original address
+         }
       }
       data_out = ac_storage::read(slot_data + offset - Data);
       //Updates the tracking for replacement policies
       this->update(set, element);
+      this->observe(address);
       return (data_out);
   }
 
   //!Reading a byte
   unsigned char ac_cache::read_byte( unsigned address )
   {
+      if(!ac_sampler::detailed)  //Fast-forwarding: the cache is bypassed
+      {
+         unsigned char datum;
+         this->functional_read(address, (char*)&datum, sizeof(datum));
+         return (datum);
+      }
       read_access_type = true;
       unsigned char data_out;                    //hold the requested Data
       this->ac_cache::addressing(address); //slicing the address field
@@ -340,20 +393,30 @@
 #ifdef AC_STATS
          ac_resources::ac_sim_stats.add_miss(name);
 #endif
-         this->stall();    //Stalls the processor, while the data is being provided
-//         replace_status = 0;
-         requested_address = address;
-         this->replaceBlockRead(requested_address);
+         if(!this->waitMSHR(address))
+         {
+             this->stall();    //Stalls the processor, while the data is being provided
+//             replace_status = 0;
+             requested_address = address;
+             this->replaceBlockRead(requested_address);
+         }
       }
       data_out = ac_storage::read_byte(slot_data + offset - Data);
       //Updates the tracking for replacement policies
       this->update(set, element);
+      this->observe(address);
       return (data_out);
   }
 
   //!Reading half word
   ac_Hword ac_cache::read_half( unsigned address )
   {
+      if(!ac_sampler::detailed)  //Fast-forwarding: the cache is bypassed
+      {
+         ac_Hword datum;
+         this->functional_read(address, (char*)&datum, sizeof(datum));
+         return (datum);
+      }
       read_access_type = true;
       ac_Hword data_out;                    //hold the requested Data
       this->ac_cache::addressing(address); //slicing the address field
@@ -369,14 +432,18 @@
 #ifdef AC_STATS
          ac_resources::ac_sim_stats.add_miss(name);
 #endif
-         this->stall();    //Stalls the processor, while the data is being provided
-//         replace_status = 0;
-         requested_address = address;
-         this->replaceBlockRead(requested_address);
+         if(!this->waitMSHR(address))
+         {
+             this->stall();    //Stalls the processor, while the data is being provided
+//             replace_status = 0;
+             requested_address = address;
+             this->replaceBlockRead(requested_address);
+         }
       }
       data_out = ac_storage::read_half(slot_data + offset - Data);
       //Updates the tracking for replacement policies
       this->update(set, element);
+      this->observe(address);
       return (data_out);
   }
 
@@ -384,6 +451,11 @@
   //!Writing into the cache
   void ac_cache::write( unsigned address, ac_word datum )
   {
+      if(!ac_sampler::detailed)  //Fast-forwarding: the cache is bypassed
+      {
+         this->functional_write(address, (const char*)&datum, sizeof(datum));
+         return;
+      }
       read_access_type = false;
       this->ac_cache::addressing(address);        //slicing the address field
 #ifdef  AC_TRACE                                  //! Trace files generating
@@ -423,7 +495,11 @@
 #ifdef AC_STATS
          ac_resources::ac_sim_stats.add_miss(name);
 #endif
-         if(this->next_level != NULL)
+         if(this->waitMSHR(address))
+         {
+             //The block is already on its way, the write is redone once it arrives
+         }
+         else if(this->next_level != NULL)
          {
             //WAIT
             if(!isWriteAround()) //Only if the data must be locally writen
@@ -446,12 +522,18 @@
          }
       }
       this->update(set, element);
+      this->observe(address);
   }
 
 
   //!Writing a byte to an address.
   void ac_cache::write_byte( unsigned address, unsigned char datum )
   {
+      if(!ac_sampler::detailed)  //Fast-forwarding: the cache is bypassed
+      {
+         this->functional_write(address, (const char*)&datum, sizeof(datum));
+         return;
+      }
       read_access_type = false;
       this->ac_cache::addressing(address);        //slicing the address field
 #ifdef  AC_TRACE                                  //! Trace files generating
@@ -487,7 +569,11 @@
 #ifdef AC_STATS
          ac_resources::ac_sim_stats.add_miss(name);
 #endif
-         if(this->next_level != NULL)
+         if(this->waitMSHR(address))
+         {
+             //The block is already on its way, the write is redone once it arrives
+         }
+         else if(this->next_level != NULL)
          {
             //WAIT
             if(!isWriteAround()) //Only if the data must be locally writen
@@ -508,12 +594,18 @@
          }
       }
       this->update(set, element);
+      this->observe(address);
   }
 
 
   //!Writing a halfword to an address.
   void ac_cache::write_half( unsigned address, unsigned short datum )
   {
+      if(!ac_sampler::detailed)  //Fast-forwarding: the cache is bypassed
+      {
+         this->functional_write(address, (const char*)&datum, sizeof(datum));
+         return;
+      }
       read_access_type = false;
       this->ac_cache::addressing(address);        //slicing the address field
 #ifdef  AC_TRACE                                  //! Trace files generating
@@ -551,7 +643,11 @@
 #ifdef AC_STATS
          ac_resources::ac_sim_stats.add_miss(name);
 #endif
-         if(this->next_level != NULL)
+         if(this->waitMSHR(address))
+         {
+             //The block is already on its way, the write is redone once it arrives
+         }
+         else if(this->next_level != NULL)
          {
             //WAIT
             if(!isWriteAround()) //Only if the data must be locally writen
@@ -572,6 +668,7 @@
          }
       }
       this->update(set, element);
+      this->observe(address);
   }
 
   //!
@@ -586,9 +683,10 @@
     set_size (ss),
     num_sets (nb/ss),
     strategy (st),
-    write_policy (wp)
+    write_policy (wp),
+    prefetcher (NULL),
+    stats (n)
   {
-    request_block_event = false;
     request_write_block_event = false;
     request_write_event = false;
 //  	SC_METHOD(process_request);
@@ -602,6 +700,9 @@
     chosen = new unsigned[this->num_sets];
 //    cout << "Chosen reference" << chosen << endl;
     tracker = new unsigned[this->num_blocks];
+    prefetched = new bool[this->num_blocks];
+    for (unsigned b = 0; b < this->num_blocks; b++)
+        prefetched[b] = false;
 
 
 //    cout << "Valid reference" << valid << endl;
@@ -610,6 +711,8 @@
     *dirty = false;
 //    request_buffer = new char[block_size*(AC_WORDSIZE/8)];
     datum_ref = new char[4];
+    ac_sampler::add_ratio(string(n) + " miss rate", &stats[ac_cache_stat_list::MISSES],
+                          &stats[ac_cache_stat_list::ACCESSES]);
 #ifdef AC_TRACE
     ac_cache::trace.open(n, ofstream::out);
 //        ac_cache::trace.open(n, ofstream::binary);
@@ -636,6 +739,7 @@
       delete[] chosen;
 //      fprintf(stderr, "Antes de detonar tracker 0x%x \n", tracker);
       delete[] tracker;
+      delete[] prefetched;
 #ifdef AC_TRACE
 //      closing the trace file generated
       ac_cache::trace.close();
@@ -733,14 +837,14 @@
   {
 //  	   cout << "requesting from" << this->get_name() << endl;
   	   // cout << "size in bytes: " << dec << size << endl;
-       client_global = client;
-       request_buffer = new char[size_bytes*(AC_WORDSIZE/8)];
+       char* request_buffer = new char[size_bytes*(AC_WORDSIZE/8)];
        for (unsigned offset_word = 0; offset_word < size_bytes; offset_word+=AC_WORDSIZE/8)
        {
           *(ac_word *)(request_buffer + offset_word) = this->read(address + offset_word);
            //cout << "bloco requisitado" << *(ac_word *)(request_buffer + offset_word) << endl;
        }
-       request_block_event = true;
+       block_responses.push_back(std::make_pair(client, request_buffer));
+       post_request();
        //client->response_block(request_buffer);
 
    }
@@ -749,9 +853,10 @@
        if (request_write_block_event) {
           request_write_block_event = false;
           client_global->response_write_block();
-       }else if (request_block_event) {
-          request_block_event = false;
-          client_global->response_block(request_buffer);
+       }else if (!block_responses.empty()) {
+          std::pair<ac_cache_if*, char*> r = block_responses.front();
+          block_responses.pop_front();
+          r.first->response_block(r.second);
        }else if (request_write_event) {
           request_write_event = false;
           client_global->response_write();
@@ -768,6 +873,7 @@
   	   client_global = client;
        ac_cache::write_byte(address, datum);
        request_write_event = true;
+       post_request();
        //notify(SC_ZERO_TIME, request_write_event);
        //client->response_write();
   }
@@ -777,6 +883,7 @@
   	   client_global = client;
        ac_cache::write_half(address, datum);
        request_write_event = true;
+       post_request();
        //notify(SC_ZERO_TIME, request_write_event);
        //client->response_write();
   }
@@ -786,6 +893,7 @@
   	   client_global = client;
        ac_cache::write(address, datum);
        request_write_event = true;
+       post_request();
        //client->response_write();
   }
 
@@ -799,11 +907,26 @@
        }
 
        request_write_block_event = true;
+       post_request();
        //client->response_write_block();
   }
 
   void ac_cache::response_block(char* block)
   {
+       int m = block_requests.front();
+       block_requests.pop_front();
+       if (m >= 0)
+       {
+            this->fillMSHR(m, block);
+            delete[] block;
+            return;
+       }
+
+       if(prefetched[slot_tag - tag])
+       {
+            stats[ac_cache_stat_list::PF_USELESS]++;
+            prefetched[slot_tag - tag] = false;
+       }
        *(slot_tag) = address_tag;
 //       cout << "address tag: " << address_tag << endl;
        *(slot_valid) = true;
@@ -865,4 +988,201 @@
   }
 
 
+/*
+################################################################################
+##############           FUNCTIONAL ACCESSES             #######################
+################################################################################
+*/
+
+  char* ac_cache::lookup(unsigned address)
+  {
+       unsigned offset_field = (AC_WORDSIZE/8) * this->block_size;
+       unsigned s = (address/offset_field) % this->num_sets;
+       unsigned t = address/(offset_field*this->num_sets);
+
+       for (unsigned line = s*set_size; line < (s+1)*set_size; line++)
+            if (valid[line] && tag[line] == t)
+                 return Data + line*block_size*AC_WORDSIZE/8 + address % offset_field;
+       return NULL;
+  }
+
+  void ac_cache::functional_read(unsigned address, char* datum, unsigned size_bytes)
+  {
+       char* data = this->lookup(address);
+
+       if (data)
+            memcpy(datum, data, size_bytes);
+       else if (this->next_level != NULL)
+            this->next_level->functional_read(address, datum, size_bytes);
+       else
+            memset(datum, 0, size_bytes);
+  }
+
+  void ac_cache::functional_write(unsigned address, const char* datum, unsigned size_bytes)
+  {
+       char* data = this->lookup(address);
+
+       //A dirty line keeps its dirty bit: writing it back later is harmless
+       if (data)
+            memcpy(data, datum, size_bytes);
+       if (this->next_level != NULL)
+            this->next_level->functional_write(address, datum, size_bytes);
+  }
+
+
+/*
+################################################################################
+##############         MSHRs AND PREFETCHING             #######################
+################################################################################
+*/
+
+  void ac_cache::set_mshrs(unsigned n)
+  {
+       mshr_entry e;
+       e.valid = false;
+       mshr.resize(n, e);
+  }
+
+  void ac_cache::set_prefetcher(ac_cache_prefetcher* p)
+  {
+       prefetcher = p;
+  }
+
+  void ac_cache::prefetch(unsigned address)
+  {
+       unsigned block_bytes = block_size*AC_WORDSIZE/8;
+       this->issuePrefetch(address - address % block_bytes);
+  }
+
+  //!A demand miss on a block already requested by an MSHR does not go to the
+  //!next level again: the processor stalls until that block arrives.
+  bool ac_cache::waitMSHR(unsigned address)
+  {
+       unsigned block_bytes = block_size*AC_WORDSIZE/8;
+       unsigned block_address = address - address % block_bytes;
+
+       for (unsigned m = 0; m < mshr.size(); m++)
+       {
+            if (mshr[m].valid && mshr[m].block_address == block_address)
+            {
+                 if (!mshr[m].demanded)
+                 {
+                      stats[ac_cache_stat_list::PF_LATE]++;
+                      mshr[m].demanded = true;
+                 }
+                 this->stall();
+                 return true;
+            }
+       }
+       return false;
+  }
+
+  void ac_cache::observe(unsigned address)
+  {
+       if (prefetcher == NULL || mshr.empty())
+           return;
+
+       unsigned block_bytes = block_size*AC_WORDSIZE/8;
+       prefetch_candidates.clear();
+       prefetcher->observe(address - address % block_bytes, block_bytes, hit == -1, prefetch_candidates);
+       for (unsigned c = 0; c < prefetch_candidates.size(); c++)
+           this->issuePrefetch(prefetch_candidates[c]);
+  }
+
+  //!Requests a block from the next level into a free MSHR. The demand
+  //!state (set, element, slot_*) is left untouched, as the FSM may be using it.
+  void ac_cache::issuePrefetch(unsigned block_address)
+  {
+       if (this->next_level == NULL || mshr.empty())
+           return;
+
+       unsigned block_bytes = block_size*AC_WORDSIZE/8;
+       unsigned pf_set = (block_address/block_bytes) % num_sets;
+       unsigned pf_tag = block_address/(block_bytes*num_sets);
+       unsigned first = pf_set*set_size;
+       unsigned e, m, line;
+
+       //Already present or in flight
+       for (e = 0; e < set_size; e++)
+           if (valid[first + e] && tag[first + e] == pf_tag)
+               return;
+       for (m = 0; m < mshr.size(); m++)
+           if (mshr[m].valid && mshr[m].block_address == block_address)
+               return;
+
+       for (m = 0; m < mshr.size(); m++)
+           if (!mshr[m].valid)
+               break;
+       if (m == mshr.size())
+       {
+           stats[ac_cache_stat_list::PF_DROPPED]++;
+           return;
+       }
+
+       //Prefers an invalid line, otherwise asks the replacement policy.
+       //Lines reserved by other MSHRs are left invalid, so skip those too.
+       line = num_blocks;
+       for (e = 0; e < set_size && line == num_blocks; e++)
+       {
+           if (!valid[first + e])
+           {
+               line = first + e;
+               for (unsigned o = 0; o < mshr.size(); o++)
+                   if (mshr[o].valid && mshr[o].line == line)
+                       line = num_blocks;
+           }
+       }
+       if (line == num_blocks)
+           line = first + get_chosen(pf_set);
+
+       //Never evict dirty data nor the line the demand access is using
+       if ((valid[line] && dirty[line]) || (tag + line) == slot_tag)
+       {
+           stats[ac_cache_stat_list::PF_DROPPED]++;
+           return;
+       }
+
+       if (valid[line] && prefetched[line])
+           stats[ac_cache_stat_list::PF_USELESS]++;
+       valid[line] = false;
+       prefetched[line] = false;
+
+       mshr[m].valid = true;
+       mshr[m].demanded = false;
+       mshr[m].block_address = block_address;
+       mshr[m].block_tag = pf_tag;
+       mshr[m].line = line;
+       stats[ac_cache_stat_list::PF_ISSUED]++;
+
+       block_requests.push_back(m);
+       this->next_level->request_block(this, block_address, block_bytes);
+  }
+
+  void ac_cache::fillMSHR(int m, char* block)
+  {
+       mshr_entry& e = mshr[m];
+
+       //The reserved line may have been refilled by a demand miss meanwhile
+       if (valid[e.line])
+       {
+            stats[ac_cache_stat_list::PF_USELESS]++;
+       }
+       else
+       {
+            char* data = Data + e.line*block_size*AC_WORDSIZE/8;
+            for (unsigned offset_word = 0; offset_word < block_size; offset_word++)
+                *(ac_word *)(data + offset_word*AC_WORDSIZE/8) = *(ac_word *)(block + offset_word*(AC_WORDSIZE/8));
+            tag[e.line] = e.block_tag;
+            valid[e.line] = true;
+            dirty[e.line] = false;
+            prefetched[e.line] = !e.demanded;
+            this->update(e.line / set_size, e.line % set_size);
+       }
+
+       e.valid = false;
+       if (e.demanded)
+            ac_resources::ac_release();
+  }
+
+
 
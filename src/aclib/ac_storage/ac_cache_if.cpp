@@ -32,6 +32,25 @@
 
 #include "ac_cache_if.H"
 
+unsigned ac_cache_if::pending = 0;
+std::deque<ac_cache_if*> ac_cache_if::completion_queue;
+
+void ac_cache_if::post_request() {
+  completion_queue.push_back(this);
+  pending++;
+}
+
+void ac_cache_if::process_pending() {
+  unsigned n = pending;
+
+  while (n--) {
+    ac_cache_if* level = completion_queue.front();
+    completion_queue.pop_front();
+    pending--;
+    level->process_request();
+  }
+}
+
 void bind(ac_cache_if& previous, ac_cache_if& next) {
   previous.bindToNext(next);
   next.bindToPrevious(previous);
@@ -81,7 +81,6 @@
   ac_mem::ac_mem( char *n, unsigned s) :
     ac_storage(n, s)
   {
-    request_block_event = false;
     request_write_block_event = false;
     request_write_event = false;
    	next_level = NULL;
@@ -134,23 +133,24 @@
   {
 //  	    cout << "requesting from" << this->get_name() << endl;
 //  	    cout << "size in bytes: " << size_bytes << endl;
-       client_global = client;
-       request_buffer = new char[size_bytes*(AC_WORDSIZE/8)];
+       char* request_buffer = new char[size_bytes*(AC_WORDSIZE/8)];
 //       cout << "request block em MEM no address: " << address << endl;
        for (unsigned offset_word = 0; offset_word < size_bytes; offset_word+=AC_WORDSIZE/8)
        {
           *(ac_word *)(request_buffer + offset_word) = this->read(address + offset_word);
 //           cout << " bloco requisitado" << *(ac_word *)(request_buffer + offset_word) << " from: " << (address + offset_word) << endl;
        }
-       request_block_event = true;
+       block_responses.push_back(std::make_pair(client, request_buffer));
+       post_request();
        //client->response_block(request_buffer);
 
    }
 
   void ac_mem::process_request() {
-       if (request_block_event) {
-          request_block_event = false;
-          client_global->response_block(request_buffer);
+       if (!block_responses.empty()) {
+          std::pair<ac_cache_if*, char*> r = block_responses.front();
+          block_responses.pop_front();
+          r.first->response_block(r.second);
        }else if (request_write_block_event) {
           request_write_block_event = false;
 //          cout << "respondendo write_block " << this->name << endl;
@@ -171,6 +171,7 @@
   	   client_global = client;
        ac_mem::write_byte(address, datum);
        request_write_event = true;
+       post_request();
        //notify(SC_ZERO_TIME, request_write_event);
        //client->response_write();
   }
@@ -180,6 +181,7 @@
   	   client_global = client;
        ac_mem::write_half(address, datum);
        request_write_event = true;
+       post_request();
        //notify(SC_ZERO_TIME, request_write_event);
        //client->response_write();
   }
@@ -189,6 +191,7 @@
   	   client_global = client;
        ac_mem::write(address, datum);
        request_write_event = true;
+       post_request();
 //       cout << " mem escrita Write: " << read(address) << endl;
        //client->response_write();
   }
@@ -207,6 +210,7 @@
        }
 //       cout << "Guardei o bloco no proximo nivel" << endl;
        request_write_block_event = true;
+       post_request();
        //client->response_write_block();
 
   }
@@ -270,5 +274,17 @@
 //       this->previous_level = (ac_mem&)&previous;
   }
 
+  void ac_mem::functional_read(unsigned address, char* datum, unsigned size_bytes)
+  {
+       for (unsigned i = 0; i < size_bytes; i++)
+            datum[i] = this->ac_storage::read_byte(address + i);
+  }
+
+  void ac_mem::functional_write(unsigned address, const char* datum, unsigned size_bytes)
+  {
+       for (unsigned i = 0; i < size_bytes; i++)
+            this->ac_storage::write_byte(address + i, datum[i]);
+  }
+
 
 
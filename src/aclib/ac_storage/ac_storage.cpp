@@ -31,6 +31,7 @@
  */
 
 #include "ac_storage.H"
+#include "ac_checkpoint.H"
 
 // constructor
 ac_storage::ac_storage(string nm, uint32_t sz) :
@@ -175,5 +176,15 @@ void ac_storage::lock()
 void ac_storage::unlock()
 {} // empty == there's no point locking the internal storage
 
+/** 
+ * Saves or restores the contents in a checkpoint.
+ * 
+ */
+void ac_storage::checkpoint(ac_checkpoint& ck)
+{
+  ck.section(name.c_str());
+  ck.sparse(data.ptr8, size);
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
@@ -0,0 +1,261 @@
+/**
+ * @file      ac_tlm2_port.cpp
+ * @author    The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ * 
+ * @version   2.0beta2
+ * @date      Mon, 19 Oct 2026 14:20:12 -0300
+ * 
+ * @brief     ArchC TLM-2.0 loosely-timed initiator port class implementation.
+ * 
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ * 
+ * This program is free software; you can redistribute it and/or modify 
+ * it under the terms of the GNU General Public License as published by 
+ * the Free Software Foundation; either version 2 of the License, or 
+ * (at your option) any later version. 
+ * 
+ * This program is distributed in the hope that it will be useful, 
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the 
+ * GNU General Public License for more details. 
+ * 
+ * You should have received a copy of the GNU General Public License 
+ * along with this program; if not, write to the Free Software 
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ */
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Standard includes
+#include <string.h>
+
+// SystemC includes
+
+// ArchC includes
+#include "ac_tlm2_port.H"
+#include "ac_module.H"
+#include "ac_utils.H"
+
+//////////////////////////////////////////////////////////////////////////////
+
+// using statements
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Forward class declarations, needed to compile
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Constructors
+
+/** 
+ * Default constructor.
+ * 
+ * @param size Size or address range of the element to be attached.
+ * @param qk Quantum keeper of the processor owning the port.
+ * 
+ */
+ac_tlm2_port::ac_tlm2_port(char const* nm, uint32_t sz,
+                           tlm_utils::tlm_quantumkeeper& qk) :
+  tlm::tlm_initiator_socket<>(nm),
+  name(nm),
+  size(sz),
+  qk_(qk),
+  dmi_valid_(false),
+  owner_(this) {
+  m_export.bind(*this);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Methods
+
+/**
+ * Moves a contiguous block, through DMI when the target granted it or
+ * through b_transport otherwise.
+ *
+ * @param cmd TLM_READ_COMMAND or TLM_WRITE_COMMAND.
+ * @param buf Buffer holding or receiving the block.
+ * @param address Address of the first byte.
+ * @param length Block length in bytes.
+ *
+ */
+void ac_tlm2_port::transport(tlm::tlm_command cmd, unsigned char* buf,
+                             uint32_t address, uint32_t length) {
+
+  if (dmi_valid_ &&
+      (address >= dmi_.get_start_address()) &&
+      (address + length - 1 <= dmi_.get_end_address()) &&
+      ((cmd == tlm::TLM_READ_COMMAND) ? dmi_.is_read_allowed()
+                                      : dmi_.is_write_allowed())) {
+    unsigned char* ptr = dmi_.get_dmi_ptr() +
+                         (address - dmi_.get_start_address());
+    ac_shared_access guard;
+
+    // Counted like a transport, so shared pages still shrink the batch.
+    ac_module::note_transport(owner_, operator->(), address);
+    if (cmd == tlm::TLM_READ_COMMAND) {
+      memcpy(buf, ptr, length);
+      qk_.inc(dmi_.get_read_latency());
+    }
+    else {
+      memcpy(ptr, buf, length);
+      qk_.inc(dmi_.get_write_latency());
+    }
+  }
+  else {
+    sc_time delay = qk_.get_local_time();
+    ac_shared_access guard;
+
+    trans_.set_command(cmd);
+    trans_.set_address(address);
+    trans_.set_data_ptr(buf);
+    trans_.set_data_length(length);
+    trans_.set_streaming_width(length);
+    trans_.set_byte_enable_ptr(0);
+    trans_.set_dmi_allowed(false);
+    trans_.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+
+    ac_module::note_transport(owner_, operator->(), address);
+    (*this)->b_transport(trans_, delay);
+
+    if (trans_.is_response_error())
+      AC_ERROR(name << ": " << ((cmd == tlm::TLM_READ_COMMAND) ? "read" : "write")
+               << " of " << length << " bytes at 0x" << std::hex << address << std::dec
+               << " failed: " << trans_.get_response_string());
+
+    // The target returns the local time plus its own latency.
+    qk_.set(delay);
+
+    if (trans_.is_dmi_allowed()) {
+      dmi_.init();
+      dmi_valid_ = (*this)->get_direct_mem_ptr(trans_, dmi_);
+    }
+  }
+
+  // Running ahead of the kernel is only allowed up to the quantum. In
+  // parallel mode the module syncs at the end of each batch instead.
+  if (!ac_module::parallel_mode && qk_.need_sync())
+    qk_.sync();
+}
+
+/** 
+ * Reads a single word.
+ * 
+ * @param buf Buffer into which the word will be copied.
+ * @param address Address from where the word will be read.
+ * @param wordsize Word size in bits.
+ * 
+ */
+void ac_tlm2_port::read(ac_ptr buf, uint32_t address, int wordsize) {
+  transport(tlm::TLM_READ_COMMAND, buf.ptr8, address, wordsize / 8);
+}
+
+/** 
+ * Reads multiple words.
+ * 
+ * @param buf Buffer into which the words will be copied.
+ * @param address Address from where the words will be read.
+ * @param wordsize Word size in bits.
+ * @param n_words Number of words to be read.
+ * 
+ */
+void ac_tlm2_port::read(ac_ptr buf, uint32_t address,
+                        int wordsize, int n_words) {
+  transport(tlm::TLM_READ_COMMAND, buf.ptr8, address,
+            (wordsize / 8) * n_words);
+}
+
+/** 
+ * Writes a single word.
+ * 
+ * @param buf Buffer from which the word will be copied.
+ * @param address Address to where the word will be written.
+ * @param wordsize Word size in bits.
+ *
+ */
+void ac_tlm2_port::write(ac_ptr buf, uint32_t address, int wordsize) {
+  transport(tlm::TLM_WRITE_COMMAND, buf.ptr8, address, wordsize / 8);
+}
+
+/** 
+ * Writes multiple words.
+ * 
+ * @param buf Buffer from which the words will be copied.
+ * @param address Address to where the words will be written.
+ * @param wordsize Word size in bits.
+ * @param n_words Number of words to be written.
+ * 
+ */
+void ac_tlm2_port::write(ac_ptr buf, uint32_t address,
+                         int wordsize, int n_words) {
+  transport(tlm::TLM_WRITE_COMMAND, buf.ptr8, address,
+            (wordsize / 8) * n_words);
+}
+
+string ac_tlm2_port::get_name() const {
+  return name;
+}
+
+uint32_t ac_tlm2_port::get_size() const {
+  return size;
+}
+
+/** 
+ * Locks the device.
+ * 
+ */
+void ac_tlm2_port::lock()
+{
+}
+
+/** 
+ * Unlocks the device.
+ * 
+ */
+void ac_tlm2_port::unlock()
+{
+}
+
+/**
+ * Non-blocking backward path. Not used by a loosely-timed initiator.
+ *
+ */
+tlm::tlm_sync_enum ac_tlm2_port::nb_transport_bw(tlm::tlm_generic_payload& /*trans*/,
+                                                 tlm::tlm_phase& /*phase*/,
+                                                 sc_time& /*delay*/)
+{
+  return tlm::TLM_ACCEPTED;
+}
+
+/**
+ * Drops the DMI grant if it overlaps a range. Called by the target.
+ *
+ * @param start First address of the range.
+ * @param end Last address of the range.
+ *
+ */
+void ac_tlm2_port::invalidate_direct_mem_ptr(sc_dt::uint64 start,
+                                             sc_dt::uint64 end)
+{
+  if ((start <= dmi_.get_end_address()) && (end >= dmi_.get_start_address()))
+    dmi_valid_ = false;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Destructors
+
+/**
+ * Default (virtual) destructor.
+ * @return Nothing.
+ */
+ac_tlm2_port::~ac_tlm2_port() {}
+
+//////////////////////////////////////////////////////////////////////////////
@@ -40,6 +40,7 @@
 
 // ArchC includes
 #include "ac_tlm_intr_port.H"
+#include "ac_module.H"
 
 //////////////////////////////////////////////////////////////////////////////
 
@@ -62,6 +63,7 @@
  */
 ac_tlm_intr_port::ac_tlm_intr_port(char const* nm, ac_intr_handler& hnd) :
   handler(hnd),
+  owner_(NULL),
   name(nm) { bind(*this); }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -84,7 +86,9 @@ ac_tlm_rsp ac_tlm_intr_port::transport(const ac_tlm_req& req) {
 
   if (req.type == WRITE) {
     rsp.status = SUCCESS;
-    handler.handle(req.data);
+    ac_module::note_interrupt();
+    if (owner_ == NULL || !owner_->post_interrupt(deliver, this, req.data))
+      handler.handle(req.data);
   }
   else {
     rsp.status = ERROR;
@@ -93,6 +97,17 @@ ac_tlm_rsp ac_tlm_intr_port::transport(const ac_tlm_req& req) {
   return rsp;
 }
 
+/**
+ * Runs the handler of an interrupt queued by the owner module.
+ *
+ * @param port The ac_tlm_intr_port the interrupt was sent to.
+ * @param value Value received by the port.
+ *
+ */
+void ac_tlm_intr_port::deliver(void* port, uint32_t value) {
+  static_cast<ac_tlm_intr_port*>(port)->handler.handle(value);
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
 // Destructors
@@ -35,11 +35,13 @@
 //////////////////////////////////////////////////////////////////////////////
 
 // Standard includes
+#include <string.h>
 
 // SystemC includes
 
 // ArchC includes
 #include "ac_tlm_port.H"
+#include "ac_module.H"
 
 //////////////////////////////////////////////////////////////////////////////
 
@@ -59,12 +61,209 @@
  * @param size Size or address range of the element to be attached.
  * 
  */
-ac_tlm_port::ac_tlm_port(char const* nm, uint32_t sz) : name(nm), size(sz) {}
+ac_tlm_port::ac_tlm_port(char const* nm, uint32_t sz) :
+  name(nm),
+  size(sz),
+  burst_support_(true),
+  burst_served_(false),
+  be_support_(true),
+  be_served_(false),
+  owner_(this),
+  dmi_support_(true),
+  dmi_served_(false) {
+  dmi_.ptr = NULL;
+  dmi_.start = 1;
+  dmi_.end = 0;
+  dmi_.access = DMI_ACCESS_NONE;
+  dmi_denied_ = dmi_;
+}
 
 //////////////////////////////////////////////////////////////////////////////
 
 // Methods
 
+/**
+ * Sends a request to the slave. In parallel mode, requests from the
+ * modules running on their own host threads are serialized here.
+ *
+ * @param req Request packet.
+ *
+ * @return The slave response.
+ */
+ac_tlm_rsp ac_tlm_port::send(const ac_tlm_req& req) {
+  ac_shared_access guard;
+
+  ac_module::note_transport(owner_, operator->(), req.addr);
+  return (*this)->transport(req);
+}
+
+/**
+ * Moves a contiguous block in a single burst transaction.
+ *
+ * @param type READ_BURST or WRITE_BURST.
+ * @param buf Buffer holding or receiving the block.
+ * @param address Address of the first byte.
+ * @param length Block length in bytes.
+ *
+ * @return true if the slave served the burst.
+ */
+bool ac_tlm_port::burst(ac_tlm_req_type type, uint8_t* buf,
+                        uint32_t address, uint32_t length) {
+  ac_tlm_req req;
+  ac_tlm_rsp rsp;
+
+  req.type = type;
+  req.dev_id = dev_id_;
+  req.addr = address;
+  req.data = 0;
+  req.length = length;
+  req.buf = buf;
+  req.initiator = this;
+
+  rsp = send(req);
+
+  // Single-word slaves answer ERROR to request types they do not know,
+  // so bursts are turned off only if the first one fails. Later errors
+  // come from the addresses, and fall back to words for this block only.
+  if (rsp.status != SUCCESS) {
+    if (!burst_served_)
+      burst_support_ = false;
+    return false;
+  }
+  burst_served_ = true;
+  return true;
+}
+
+/**
+ * Writes the enabled bytes of a 64-bit data word in a single WRITE_BE
+ * transaction, or by read-modify-write if the slave has no byte enables.
+ *
+ * @param address Address of byte 0 of data.
+ * @param data Data word, in target memory byte order.
+ * @param byte_enable Bit i set writes byte i of data.
+ *
+ */
+void ac_tlm_port::write_masked(uint32_t address, uint64_t data,
+                               uint8_t byte_enable) {
+  ac_tlm_req req;
+  ac_tlm_rsp rsp;
+
+  req.dev_id = dev_id_;
+  req.addr = address;
+
+  // A whole word needs no byte enables, and every slave knows WRITE.
+  if (byte_enable == 0xff) {
+    req.type = WRITE;
+    req.data = data;
+    send(req);
+    return;
+  }
+
+  if (be_support_) {
+    req.type = WRITE_BE;
+    req.data = data;
+    req.byte_enable = byte_enable;
+    rsp = send(req);
+    if (rsp.status == SUCCESS) {
+      be_served_ = true;
+      return;
+    }
+
+    // Slaves that do not know WRITE_BE answer ERROR, so byte enables are
+    // turned off only if the first one fails. Later errors come from the
+    // address, and fall back to read-modify-write for this word only.
+    if (!be_served_)
+      be_support_ = false;
+  }
+
+  req.type = READ;
+  req.data = 0ULL;
+  rsp = send(req);
+
+  req.type = WRITE;
+  req.data = rsp.data;
+  for (int j = 0; j < 8; j++)
+    if (byte_enable & (1 << j))
+      ((uint8_t*)&req.data)[j] = ((uint8_t*)&data)[j];
+  send(req);
+}
+
+/**
+ * Looks up the host address of a range through DMI, asking the slave
+ * for a grant when the range is not known yet.
+ *
+ * @param address Address of the first byte.
+ * @param length Range length in bytes.
+ * @param access Access that will be made.
+ *
+ * @return Host pointer, or NULL if the access must go through transport().
+ */
+uint8_t* ac_tlm_port::dmi_ptr(uint32_t address, uint32_t length,
+                              ac_tlm_dmi_access access) {
+  uint32_t last = address + length - 1;
+
+  if ((address >= dmi_.start) && (last <= dmi_.end))
+    return (dmi_.access & access) ? dmi_.ptr + (address - dmi_.start) : NULL;
+
+  if (!dmi_support_ ||
+      ((address >= dmi_denied_.start) && (address <= dmi_denied_.end)))
+    return NULL;
+
+  ac_tlm_req req;
+  ac_tlm_rsp rsp;
+
+  req.type = DMI;
+  req.dev_id = dev_id_;
+  req.addr = address;
+  req.data = 0;
+  req.initiator = this;
+
+  rsp = send(req);
+
+  // Slaves unaware of DMI answer ERROR, so DMI is turned off only if
+  // the first request fails. Later errors come from the address (a router
+  // with nothing mapped there), and only deny the range asked for.
+  if (rsp.status != SUCCESS) {
+    if (!dmi_served_)
+      dmi_support_ = false;
+    else {
+      dmi_denied_.start = address;
+      dmi_denied_.end = last;
+    }
+    return NULL;
+  }
+  dmi_served_ = true;
+
+  if (rsp.dmi.ptr == NULL) {
+    dmi_denied_ = rsp.dmi;
+    return NULL;
+  }
+
+  dmi_ = rsp.dmi;
+  if ((address >= dmi_.start) && (last <= dmi_.end) && (dmi_.access & access))
+    return dmi_.ptr + (address - dmi_.start);
+  return NULL;
+}
+
+/**
+ * Copies a block to or from a DMI grant. The copy is serialized and
+ * counted like a transport, so that shared pages still count as
+ * interactions between modules.
+ *
+ * @param dst Destination buffer.
+ * @param src Source buffer.
+ * @param length Block length in bytes.
+ * @param address Target address of the block.
+ *
+ */
+void ac_tlm_port::dmi_copy(uint8_t* dst, const uint8_t* src, uint32_t length,
+                           uint32_t address) {
+  ac_shared_access guard;
+
+  ac_module::note_transport(owner_, operator->(), address);
+  memcpy(dst, src, length);
+}
+
 /** 
  * Reads a single word.
  * 
@@ -76,12 +275,18 @@ ac_tlm_port::ac_tlm_port(char const* nm, uint32_t sz) : name(nm), size(sz) {}
 void ac_tlm_port::read(ac_ptr buf, uint32_t address, int wordsize) {
   ac_tlm_req req;
   ac_tlm_rsp rsp;
+  uint8_t* host = dmi_ptr(address, wordsize / 8, DMI_ACCESS_READ);
+
+  if (host) {
+    dmi_copy(buf.ptr8, host, wordsize / 8, address);
+    return;
+  }
 
   req.type = READ;
   req.addr = address;
   req.data = 0ULL;
 
-  rsp = (*this)->transport(req);
+  rsp = send(req);
 
   if (rsp.status == SUCCESS) {
     switch (wordsize) {
@@ -116,6 +321,17 @@ void ac_tlm_port::read(ac_ptr buf, uint32_t address,
 		       int wordsize, int n_words) {
   ac_tlm_req req;
   ac_tlm_rsp rsp;
+  uint32_t length = n_words * (wordsize / 8);
+  uint8_t* host = dmi_ptr(address, length, DMI_ACCESS_READ);
+
+  if (host) {
+    dmi_copy(buf.ptr8, host, length, address);
+    return;
+  }
+
+  if ((n_words > 1) && burst_support_ &&
+      burst(READ_BURST, buf.ptr8, address, length))
+    return;
 
   req.type = READ;
 
@@ -125,7 +341,7 @@ void ac_tlm_port::read(ac_ptr buf, uint32_t address,
       req.addr = address + i;
       req.data = 0ULL;
       
-      rsp = (*this)->transport(req);
+      rsp = send(req);
       
       if (rsp.status == SUCCESS) {
 	for (int j = 0; (i < n_words) && (j < 4); i++, j++) { 
@@ -140,7 +356,7 @@ void ac_tlm_port::read(ac_ptr buf, uint32_t address,
       req.addr = address + (i * sizeof(uint16_t));
       req.data = 0ULL;
       
-      rsp = (*this)->transport(req);
+      rsp = send(req);
       
       if (rsp.status == SUCCESS) {
 	for (int j = 0; (i < n_words) && (j < 2); i++, j++) { 
@@ -155,7 +371,7 @@ void ac_tlm_port::read(ac_ptr buf, uint32_t address,
       req.addr = address + (i * sizeof(uint32_t));
       req.data = 0ULL;
       
-      rsp = (*this)->transport(req);
+      rsp = send(req);
       
       if (rsp.status == SUCCESS) {
 	for (int j = 0; (i < n_words) && (j < 1); i++, j++) { 
@@ -170,7 +386,7 @@ void ac_tlm_port::read(ac_ptr buf, uint32_t address,
       req.addr = address + (i * sizeof(uint64_t));
       req.data = 0ULL;
       
-      rsp = (*this)->transport(req);
+      rsp = send(req);
       
       if (rsp.status == SUCCESS) {
 	(buf.ptr64)[i] = rsp.data;
@@ -193,54 +409,36 @@ void ac_tlm_port::read(ac_ptr buf, uint32_t address,
 void ac_tlm_port::write(ac_ptr buf, uint32_t address, int wordsize) {
   ac_tlm_req req;
   ac_tlm_rsp rsp;
+  uint8_t* host = dmi_ptr(address, wordsize / 8, DMI_ACCESS_WRITE);
 
-//   req.type = WRITE;
-//   req.addr = address;
-
-  // It would be necessary to read 64 bits and mix the bits with the smaller
-  // words that will be written
+  if (host) {
+    dmi_copy(host, buf.ptr8, wordsize / 8, address);
+    return;
+  }
 
-  // Rodolfo: This should be not necessary. Trying with only 32 bits...
+  // Sub-word and 64-bit writes carry byte enables, so the slave knows
+  // which bytes to change.
   switch (wordsize) {
   case 8:
-    req.type = READ;
-    req.addr = address;
-    rsp = (*this)->transport(req);
-
-    req.type = WRITE;
-    req.data = rsp.data;
+    req.data = 0ULL;
     ((uint8_t*)&(req.data))[0] = *(buf.ptr8);
-    rsp = (*this)->transport(req);
+    write_masked(address, req.data, 0x01);
     break;
   case 16:
-    req.type = READ;
-    req.addr = address;
-    rsp = (*this)->transport(req);
-
-    req.type = WRITE;
-    req.data = rsp.data;
-    ((uint16_t*)&(req.data))[0] =
-      *(buf.ptr16);
-    rsp = (*this)->transport(req);
+    req.data = 0ULL;
+    ((uint16_t*)&(req.data))[0] = *(buf.ptr16);
+    write_masked(address, req.data, 0x03);
     break;
   case 32:
- //   req.type = READ;
-    req.addr = address;
- //   rsp = (*this)->transport(req);
-
     req.type = WRITE;
-    req.data = rsp.data;
+    req.addr = address;
+    req.data = 0ULL;
     ((uint32_t*)&(req.data))[0] =
       *(buf.ptr32);
-    rsp = (*this)->transport(req);
+    rsp = send(req);
     break;
-
-// This is not a 64-bit operation!
   case 64:
-    req.type = WRITE;
-    req.addr = address;
-    req.data = *(buf.ptr64);
-    rsp = (*this)->transport(req);
+    write_masked(address, *(buf.ptr64), 0xff);
     break;
   default:
     break;
@@ -259,41 +457,47 @@ void ac_tlm_port::write(ac_ptr buf, uint32_t address, int wordsize) {
 void ac_tlm_port::write(ac_ptr buf, uint32_t address,
 			int wordsize, int n_words) {
   ac_tlm_req req;
-  ac_tlm_rsp rsp;
+  uint32_t length = n_words * (wordsize / 8);
+  uint8_t* host = dmi_ptr(address, length, DMI_ACCESS_WRITE);
+
+  if (host) {
+    dmi_copy(host, buf.ptr8, length, address);
+    return;
+  }
+
+  if ((n_words > 1) && burst_support_ &&
+      burst(WRITE_BURST, buf.ptr8, address, length))
+    return;
+
+  uint8_t byte_enable;
 
   switch (wordsize) {
   case 8:
     for (int i = 0; i < n_words; i++) {
-      req.type = READ;
       req.addr = address + i;
       req.data = 0ULL;
-      rsp = (*this)->transport(req);
-
-      req.type = WRITE;
-      req.data = rsp.data;
+      byte_enable = 0;
 
       for (int j = 0; (i < n_words) && (j < 4); j++, i++) {
 	((uint8_t*)&req.data)[j] = (buf.ptr8)[i];
+	byte_enable |= 1 << j;
       }
       i--;
-      (*this)->transport(req);
+      write_masked(req.addr, req.data, byte_enable);
     }
     break;
   case 16:
     for (int i = 0; i < n_words; i++) {
-      req.type = READ;
       req.addr = address + (i * sizeof(uint16_t));
       req.data = 0ULL;
-      rsp = (*this)->transport(req);
-
-      req.type = WRITE;
-      req.data = rsp.data;
+      byte_enable = 0;
 
       for (int j = 0; (i < n_words) && (j < 2); j++, i++) {
 	((uint16_t*)&req.data)[j] = (buf.ptr16)[i];
+	byte_enable |= 3 << (2 * j);
       }
       i--;
-      (*this)->transport(req);
+      write_masked(req.addr, req.data, byte_enable);
     }
     break;
   case 32:
@@ -311,15 +515,12 @@ void ac_tlm_port::write(ac_ptr buf, uint32_t address,
 //        ((uint32_t*)&req.data)[j] = (buf.ptr32)[i];
 //      }
 //      i--;
-      (*this)->transport(req);
+      send(req);
     }
     break;
   case 64:
-    for (int i = 0; i < n_words; i++) {
-      req.addr = address + (i * sizeof(uint64_t));
-      req.data = (buf.ptr64)[i];
-      (*this)->transport(req);
-    }
+    for (int i = 0; i < n_words; i++)
+      write_masked(address + (i * sizeof(uint64_t)), (buf.ptr64)[i], 0xff);
     break;
   default:
     break;
@@ -343,7 +544,7 @@ void ac_tlm_port::lock()
   ac_tlm_req req;
   req.type = LOCK;
   req.dev_id = dev_id_;
-  (*this)->transport(req);
+  send(req);
 }
 
 /** 
@@ -355,7 +556,29 @@ void ac_tlm_port::unlock()
   ac_tlm_req req;
   req.type = UNLOCK;
   req.dev_id = dev_id_;
-  (*this)->transport(req);
+  send(req);
+}
+
+/**
+ * Drops the DMI grants overlapping a range. Called by the slave.
+ *
+ * @param start First address of the range.
+ * @param end Last address of the range.
+ *
+ */
+void ac_tlm_port::invalidate_dmi(uint32_t start, uint32_t end)
+{
+  if ((start <= dmi_.end) && (end >= dmi_.start)) {
+    dmi_.ptr = NULL;
+    dmi_.start = 1;
+    dmi_.end = 0;
+  }
+
+  // A revoked range may be granted again later.
+  if ((start <= dmi_denied_.end) && (end >= dmi_denied_.start)) {
+    dmi_denied_.start = 1;
+    dmi_denied_.end = 0;
+  }
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,262 @@
+/**
+ * @file      ac_checkpoint.cpp
+ * @author    The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ * @date      Mon, 19 Oct 2026 14:05:12 -0300
+ *
+ * @brief     Checkpoint files for saving and restoring simulator state.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ac_checkpoint.H"
+#include "ac_utils.H"
+
+//File format: the magic string, then the sections in the order the
+//simulator walks them. A section is its name length and name followed by
+//whatever its owner wrote; sparse memories are a list of page numbers and
+//pages ending with AC_CKPT_END.
+#define AC_CKPT_MAGIC     "ACCKPT01"
+#define AC_CKPT_PAGE      4096
+#define AC_CKPT_END       0xffffffffU
+
+std::map<int, ac_checkpoint::open_file> ac_checkpoint::open_files;
+char* ac_checkpoint::save_file = 0;
+volatile unsigned long long ac_checkpoint::save_at = ~0ULL;
+char* ac_checkpoint::restore_file = 0;
+
+ac_checkpoint::ac_checkpoint(const char* name, bool saving, bool fatal_errors) :
+  save(saving),
+  fatal(fatal_errors),
+  error(false),
+  filename(name) {
+
+  char magic[sizeof(AC_CKPT_MAGIC)] = AC_CKPT_MAGIC;
+
+  file = fopen(name, save ? "wb" : "rb");
+  if (!file) {
+    fail(strerror(errno));
+    return;
+  }
+
+  if (save)
+    data(magic, sizeof(magic));
+  else {
+    data(magic, sizeof(magic));
+    if (strcmp(magic, AC_CKPT_MAGIC))
+      fail("not an ArchC checkpoint file");
+  }
+}
+
+ac_checkpoint::~ac_checkpoint() {
+  if (!file)
+    return;
+  if (save && !error && (fflush(file) || ferror(file)))
+    fail(strerror(errno));
+  fclose(file);
+  reopen_files();
+}
+
+void ac_checkpoint::fail(const char* what) {
+  if (!fatal) {
+    error = true;
+    return;
+  }
+  AC_ERROR("Checkpoint file '" << filename << "': " << what);
+  exit(EXIT_FAILURE);
+}
+
+void ac_checkpoint::data(void* p, uint32_t n) {
+  if (error) {
+    if (!save)
+      memset(p, 0, n);
+    return;
+  }
+  size_t done = save ? fwrite(p, 1, n, file) : fread(p, 1, n, file);
+  if (done != n)
+    fail(save ? "write error" : "truncated file");
+}
+
+void ac_checkpoint::rewind() {
+  if (!error && fseek(file, sizeof(AC_CKPT_MAGIC), SEEK_SET))
+    fail(strerror(errno));
+}
+
+void ac_checkpoint::section(const char* name) {
+  uint32_t len = strlen(name);
+
+  if (save) {
+    value(len);
+    data((void*) name, len);
+    return;
+  }
+
+  uint32_t saved_len;
+  value(saved_len);
+  if (saved_len > AC_CKPT_PAGE) {
+    fail("not a section name");
+    return;
+  }
+  std::string saved(saved_len, '\0');
+  if (saved_len)
+    data(&saved[0], saved_len);
+  if (saved != name) {
+    std::string msg = "expected section '" + std::string(name) + "', found '" + saved +
+                      "' (was it saved by another model?)";
+    fail(msg.c_str());
+  }
+}
+
+void ac_checkpoint::sparse(unsigned char* mem, uint32_t size) {
+  uint32_t page, saved_size = size;
+  static const unsigned char zero[AC_CKPT_PAGE] = { 0 };
+
+  value(saved_size);
+  if (saved_size != size) {
+    fail("storage size does not match the model");
+    return;
+  }
+
+  if (save) {
+    for (page = 0; page * AC_CKPT_PAGE < size; page++) {
+      uint32_t offset = page * AC_CKPT_PAGE;
+      uint32_t n = (size - offset < AC_CKPT_PAGE) ? size - offset : AC_CKPT_PAGE;
+      if (!memcmp(mem + offset, zero, n))
+        continue;
+      value(page);
+      data(mem + offset, n);
+    }
+    page = AC_CKPT_END;
+    value(page);
+    return;
+  }
+
+  if (mem)
+    memset(mem, 0, size);
+  for (value(page); page != AC_CKPT_END && !error; value(page)) {
+    uint64_t offset = (uint64_t) page * AC_CKPT_PAGE;
+    if (offset >= size) {
+      fail("page out of range");
+      return;
+    }
+    uint32_t n = (size - offset < AC_CKPT_PAGE) ? size - offset : AC_CKPT_PAGE;
+    if (mem)
+      data(mem + offset, n);
+    else if (fseek(file, n, SEEK_CUR))
+      fail("truncated file");
+  }
+}
+
+void ac_checkpoint::files() {
+  uint32_t count = open_files.size();
+
+  section("files");
+  value(count);
+
+  if (save) {
+    std::map<int, open_file>::iterator i;
+    for (i = open_files.begin(); i != open_files.end(); i++) {
+      int fd = i->first;
+      uint32_t len = i->second.path.size();
+      int64_t offset = lseek(fd, 0, SEEK_CUR);   //-1 for pipes and terminals
+      value(fd);
+      value(i->second.flags);
+      value(offset);
+      value(len);
+      data(&i->second.path[0], len);
+    }
+    return;
+  }
+
+  open_files.clear();
+  while (count--) {
+    int fd, flags;
+    int64_t offset;
+    uint32_t len;
+    value(fd);
+    value(flags);
+    value(offset);
+    value(len);
+    std::string path(len, '\0');
+    if (len)
+      data(&path[0], len);
+    file_opened(fd, path.c_str(), flags);
+    reopen[fd] = offset;
+  }
+}
+
+void ac_checkpoint::reopen_files() {
+  std::map<int, int64_t>::iterator i;
+
+  for (i = reopen.begin(); i != reopen.end(); i++) {
+    int fd = i->first;
+    open_file& f = open_files[fd];
+
+    //The file exists by now, and must keep what was written to it.
+    int host_fd = open(f.path.c_str(), f.flags & ~(O_CREAT | O_TRUNC | O_EXCL));
+    if (host_fd < 0) {
+      std::string msg = "cannot reopen '" + f.path + "': " + strerror(errno);
+      fail(msg.c_str());
+    }
+    if (host_fd != fd) {
+      dup2(host_fd, fd);
+      close(host_fd);
+    }
+    if (i->second >= 0)
+      lseek(fd, i->second, SEEK_SET);
+  }
+  reopen.clear();
+}
+
+void ac_checkpoint::request(int signal) {
+  save_at = 0;
+}
+
+void ac_checkpoint::file_opened(int fd, const char* path, int flags) {
+  if (fd < 0)
+    return;
+  open_files[fd].path = path;
+  open_files[fd].flags = flags;
+}
+
+void ac_checkpoint::file_closed(int fd) {
+  open_files.erase(fd);
+}
+
+void ac_checkpoint::file_duped(int oldfd, int newfd) {
+  if (newfd < 0 || oldfd == newfd)
+    return;
+  std::map<int, open_file>::iterator i = open_files.find(oldfd);
+  if (i == open_files.end())
+    open_files.erase(newfd);
+  else
+    open_files[newfd] = i->second;
+}
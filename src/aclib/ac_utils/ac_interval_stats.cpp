@@ -0,0 +1,144 @@
+/**
+ * @file      ac_interval_stats.cpp
+ * @author    The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ * @date      Mon, 19 Oct 2026 20:12:40 -0300
+ *
+ * @brief     Statistics records written at regular intervals of the
+ *            simulation.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "ac_interval_stats.H"
+#include "ac_stats_base.H"
+#include "ac_timing.H"
+#include "ac_utils.H"
+
+FILE* ac_interval_stats::file = 0;
+bool ac_interval_stats::csv = false;
+bool ac_interval_stats::by_time = false;
+unsigned long long ac_interval_stats::interval = 0;
+double ac_interval_stats::next_time = 0;
+unsigned long long ac_interval_stats::last_instr = 0;
+double ac_interval_stats::last_host = 0;
+double ac_interval_stats::start_host = 0;
+
+char* ac_interval_stats::file_name = 0;
+unsigned long long ac_interval_stats::next_at = ~0ULL;
+
+bool ac_interval_stats::configure(const char* spec) {
+  const char *sep = strrchr(spec, ':');
+  char *end;
+  size_t len;
+
+  if (!sep || sep == spec)
+    return false;
+  interval = strtoull(sep + 1, &end, 10);
+  by_time = !strcmp(end, "ns");
+  if (end == sep + 1 || (*end && !by_time) || !interval)
+    return false;
+
+  //A variant gets its own file
+  if (file)
+    fclose(file);
+  file = 0;
+  free(file_name);
+  file_name = strndup(spec, sep - spec);
+  len = strlen(file_name);
+  csv = len > 4 && !strcmp(file_name + len - 4, ".csv");
+
+  start_host = last_host = ac_timing::now();
+  next_at = by_time ? ~0ULL : last_instr + interval;
+  next_time = interval;
+  return true;
+}
+
+void ac_interval_stats::write(unsigned long long instr_counter, double sim_ns) {
+  std::vector<std::string> names;
+  std::vector<long long> values;
+  double now = ac_timing::now();
+  unsigned i;
+
+  ac_stats_base::collect_all_stats(names, values);
+  double ips = (now > last_host) ? (instr_counter - last_instr) / (now - last_host) : 0;
+
+  if (!file) {
+    if (!(file = fopen(file_name, "w"))) {
+      AC_ERROR("Cannot write the interval statistics to " << file_name << ": " << strerror(errno));
+      next_at = ~0ULL;
+      by_time = false;
+      return;
+    }
+    //The set of counters is fixed once the model is elaborated.
+    if (csv) {
+      fprintf(file, "instructions,host_seconds,ips,sim_ns");
+      for (i = 0; i < names.size(); i++)
+        fprintf(file, ",%s", names[i].c_str());
+      fprintf(file, "\n");
+    }
+  }
+
+  if (csv) {
+    fprintf(file, "%llu,%.6f,%.0f,", instr_counter, now - start_host, ips);
+    if (sim_ns >= 0)
+      fprintf(file, "%.0f", sim_ns);
+    for (i = 0; i < values.size(); i++)
+      fprintf(file, ",%lld", values[i]);
+    fprintf(file, "\n");
+  }
+  else {
+    fprintf(file, "{\"instructions\":%llu,\"host_seconds\":%.6f,\"ips\":%.0f",
+            instr_counter, now - start_host, ips);
+    if (sim_ns >= 0)
+      fprintf(file, ",\"sim_ns\":%.0f", sim_ns);
+    for (i = 0; i < names.size(); i++)
+      fprintf(file, ",\"%s\":%lld", names[i].c_str(), values[i]);
+    fprintf(file, "}\n");
+  }
+  //Readers follow the file while the simulation runs.
+  fflush(file);
+
+  last_instr = instr_counter;
+  last_host = now;
+  if (by_time) {
+    while (next_time <= sim_ns)
+      next_time += interval;
+  }
+  else
+    next_at = instr_counter + interval;
+}
+
+void ac_interval_stats::finish(unsigned long long instr_counter, double sim_ns) {
+  if (!file_name)
+    return;
+
+  if (!file || instr_counter != last_instr)
+    write(instr_counter, sim_ns);
+  if (file)
+    fclose(file);
+  file = 0;
+  next_at = ~0ULL;
+  by_time = false;
+}
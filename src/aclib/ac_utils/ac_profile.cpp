@@ -0,0 +1,361 @@
+/**
+ * @file      ac_profile.cpp
+ * @author    The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ * @date      Mon, 19 Oct 2026 19:03:51 -0300
+ *
+ * @brief     Per-PC execution profile of the target application.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include <algorithm>
+
+#include "ac_profile.H"
+#include "ac_utils.H"
+
+//Number of entries in each list of the report.
+#define AC_PROFILE_TOP 20
+
+//Frames searched for the target of a return. A longjmp() over more frames
+//leaves them on the shadow stack, charged until the end of the run.
+#define AC_CALLGRAPH_SCAN 16
+
+extern char* appfilename;
+
+char* ac_profile::dump_file = 0;
+char* ac_profile::callgraph_file = 0;
+
+ac_profile::~ac_profile() {
+  free(counts);
+}
+
+void ac_profile::init(unsigned sz) {
+  free(counts);
+  size = sz;
+  counts = (unsigned long long*) calloc(size, sizeof(unsigned long long));
+  if (!counts) {
+    AC_ERROR("Not enough memory for the execution profile.");
+    exit(EXIT_FAILURE);
+  }
+}
+
+//The symbol table is read with the byte order of the file, whatever the
+//byte order of the model or the host.
+static bool elf_swap;
+
+static uint16_t elf16(uint16_t v) { return elf_swap ? byte_swap(v) : v; }
+static uint32_t elf32(uint32_t v) { return elf_swap ? byte_swap(v) : v; }
+
+static bool read_at(int fd, off_t offset, void* buf, size_t n) {
+  return lseek(fd, offset, SEEK_SET) == offset && read(fd, buf, n) == (ssize_t) n;
+}
+
+void ac_profile::read_symbols(const char* elf_file) {
+  Elf32_Ehdr ehdr;
+  Elf32_Shdr shdr, strhdr;
+  int fd;
+  unsigned i;
+  uint16_t one = 1;
+
+  functions.clear();
+  symbols_read = true;
+
+  if (!elf_file || (fd = open(elf_file, O_RDONLY)) == -1)
+    return;
+
+  if (!read_at(fd, 0, &ehdr, sizeof(ehdr)) || strncmp((char*) ehdr.e_ident, ELFMAG, 4) ||
+      ehdr.e_ident[EI_CLASS] != ELFCLASS32) {
+    close(fd);
+    return;
+  }
+  elf_swap = (ehdr.e_ident[EI_DATA] == ELFDATA2MSB) == (*(unsigned char*) &one == 1);
+
+  for (i = 0; i < elf16(ehdr.e_shnum); i++) {
+    if (!read_at(fd, elf32(ehdr.e_shoff) + i * elf16(ehdr.e_shentsize), &shdr, sizeof(shdr)))
+      break;
+    if (elf32(shdr.sh_type) != SHT_SYMTAB)
+      continue;
+
+    if (!read_at(fd, elf32(ehdr.e_shoff) + elf32(shdr.sh_link) * elf16(ehdr.e_shentsize),
+                 &strhdr, sizeof(strhdr)))
+      break;
+
+    std::vector<Elf32_Sym> symbols(elf32(shdr.sh_size) / sizeof(Elf32_Sym));
+    std::vector<char> strings(elf32(strhdr.sh_size) + 1, '\0');
+    if (symbols.empty() ||
+        !read_at(fd, elf32(shdr.sh_offset), &symbols[0], symbols.size() * sizeof(Elf32_Sym)) ||
+        !read_at(fd, elf32(strhdr.sh_offset), &strings[0], strings.size() - 1))
+      break;
+
+    for (unsigned s = 0; s < symbols.size(); s++) {
+      Elf32_Sym& sym = symbols[s];
+      unsigned name = elf32(sym.st_name);
+      function f;
+
+      if (ELF32_ST_TYPE(sym.st_info) != STT_FUNC || elf16(sym.st_shndx) == SHN_UNDEF ||
+          name >= strings.size())
+        continue;
+      f.address = elf32(sym.st_value);
+      f.size = elf32(sym.st_size);
+      f.name = &strings[name];
+      f.count = 0;
+      f.inclusive = 0;
+      f.calls = 0;
+      f.active = 0;
+      functions.push_back(f);
+    }
+    break;
+  }
+  close(fd);
+
+  std::sort(functions.begin(), functions.end());
+}
+
+int ac_profile::find(unsigned pc) {
+  function key;
+  key.address = pc;
+
+  //The last function starting at or before pc, if pc is inside it
+  std::vector<function>::iterator f = std::upper_bound(functions.begin(), functions.end(), key);
+  if (f == functions.begin())
+    return -1;
+  --f;
+  if (f->size && pc - f->address >= f->size)
+    return -1;
+  return f - functions.begin();
+}
+
+void ac_profile::transfer(unsigned pc) {
+  if (!symbols_read)
+    read_symbols(appfilename);
+
+  //The first instruction opens the root frame.
+  if (stack.empty()) {
+    enter(find(pc));
+    return;
+  }
+
+  //Back to the fall-through of one of the latest calls
+  for (unsigned i = stack.size() - 1; i > 0 && stack.size() - i <= AC_CALLGRAPH_SCAN; i--)
+    if (stack[i].ret == pc) {
+      while (stack.size() > i)
+        leave();
+      return;
+    }
+
+  //A jump to its own entry from inside the function is taken for a loop
+  //or a self tail call, so that it does not pile up frames.
+  int f = find(pc);
+  if (f >= 0 && functions[f].address == pc && !(stack.back().function == f && find(last_pc) == f))
+    enter(f);
+}
+
+void ac_profile::enter(int f) {
+  frame fr;
+
+  if (!stack.empty()) {
+    arc& a = arcs[std::make_pair(stack.back().function, f)];
+    if (!a.calls)
+      a.site = last_pc;
+    a.calls++;
+  }
+  if (f >= 0) {
+    functions[f].calls++;
+    functions[f].active++;
+  }
+
+  fr.function = f;
+  fr.ret = next_pc;
+  fr.start = executed;
+  stack.push_back(fr);
+}
+
+void ac_profile::leave() {
+  frame fr = stack.back();
+  unsigned long long cost = executed - fr.start;
+
+  stack.pop_back();
+  //Recursive calls are already inside the outermost frame.
+  if (fr.function >= 0 && !--functions[fr.function].active)
+    functions[fr.function].inclusive += cost;
+  if (!stack.empty())
+    arcs[std::make_pair(stack.back().function, fr.function)].inclusive += cost;
+}
+
+//Writes the call graph in the format of callgrind, which kcachegrind and
+//callgrind_annotate read: per-address self counts and, for every pair of
+//functions, the calls and the instructions executed inside them.
+void ac_profile::write_callgraph(const char* elf_file) {
+  FILE* out;
+  unsigned long long total = 0;
+  unsigned i;
+  int current = -2;
+
+  if (!(out = fopen(callgraph_file, "w"))) {
+    AC_ERROR("Cannot write the call graph to " << callgraph_file << ": " << strerror(errno));
+    return;
+  }
+
+  for (i = 0; i < size; i++)
+    total += counts[i];
+
+  fprintf(out, "# callgrind format\n");
+  fprintf(out, "version: 1\n");
+  fprintf(out, "creator: ArchC\n");
+  fprintf(out, "cmd: %s\n", elf_file ? elf_file : "??");
+  fprintf(out, "positions: instr\n");
+  fprintf(out, "events: Ir\n");
+  fprintf(out, "summary: %llu\n\n", total);
+
+  for (i = 0; i < size; i++) {
+    if (!counts[i])
+      continue;
+    int f = find(i);
+    if (f != current)
+      fprintf(out, "fn=%s\n", (f >= 0) ? functions[f].name.c_str() : "??");
+    current = f;
+    fprintf(out, "0x%x %llu\n", i, counts[i]);
+  }
+
+  for (std::map<std::pair<int, int>, arc>::iterator a = arcs.begin(); a != arcs.end(); ++a) {
+    int caller = a->first.first, callee = a->first.second;
+    if (caller != current)
+      fprintf(out, "fn=%s\n", (caller >= 0) ? functions[caller].name.c_str() : "??");
+    current = caller;
+    fprintf(out, "cfn=%s\n", (callee >= 0) ? functions[callee].name.c_str() : "??");
+    fprintf(out, "calls=%llu 0x%x\n", a->second.calls, (callee >= 0) ? functions[callee].address : 0);
+    fprintf(out, "0x%x %llu\n", a->second.site, a->second.inclusive);
+  }
+
+  fclose(out);
+  fprintf(stderr, "    Call graph written to %s\n", callgraph_file);
+}
+
+//Sorting helper: hottest first.
+static bool hotter(const std::pair<unsigned long long, int>& a,
+                   const std::pair<unsigned long long, int>& b) {
+  return a.first > b.first;
+}
+
+void ac_profile::report(const char* elf_file) {
+  std::vector<std::pair<unsigned long long, int> > hot_functions;
+  std::vector<std::pair<unsigned long long, int> > hot_pcs;
+  unsigned long long total = 0, unknown = 0;
+  unsigned i, n;
+  FILE* dump = 0;
+
+  if (!counts)
+    return;
+
+  if (!symbols_read)
+    read_symbols(elf_file);
+
+  //Frames still open at the end of the run return there.
+  while (!stack.empty())
+    leave();
+
+  for (i = 0; i < size; i++) {
+    if (!counts[i])
+      continue;
+    int f = find(i);
+    total += counts[i];
+    if (f >= 0)
+      functions[f].count += counts[i];
+    else
+      unknown += counts[i];
+    hot_pcs.push_back(std::make_pair(counts[i], (int) i));
+  }
+  if (!total)
+    return;
+
+  for (i = 0; i < functions.size(); i++)
+    if (functions[i].count)
+      hot_functions.push_back(std::make_pair(functions[i].count, (int) i));
+  if (unknown)
+    hot_functions.push_back(std::make_pair(unknown, -1));
+  std::sort(hot_functions.begin(), hot_functions.end(), hotter);
+
+  n = std::min((unsigned) hot_pcs.size(), (unsigned) AC_PROFILE_TOP);
+  std::partial_sort(hot_pcs.begin(), hot_pcs.begin() + n, hot_pcs.end(), hotter);
+
+  fprintf(stderr, "ArchC: Execution profile (%llu instructions)\n", total);
+  if (callgraph_file)
+    fprintf(stderr, "    Hot functions (self, inclusive, calls):\n");
+  else
+    fprintf(stderr, "    Hot functions:\n");
+  for (i = 0; i < hot_functions.size() && i < AC_PROFILE_TOP; i++) {
+    int f = hot_functions[i].second;
+    fprintf(stderr, "    %6.2f%% %14llu  ", 100.0 * hot_functions[i].first / total,
+            hot_functions[i].first);
+    if (callgraph_file && f >= 0)
+      fprintf(stderr, "%6.2f%% %14llu %10llu  ", 100.0 * functions[f].inclusive / total,
+              functions[f].inclusive, functions[f].calls);
+    else if (callgraph_file)
+      fprintf(stderr, "%35s", "");
+    fprintf(stderr, "%s\n", (f >= 0) ? functions[f].name.c_str() : "??");
+  }
+
+  fprintf(stderr, "    Hot instructions:\n");
+  for (i = 0; i < n; i++) {
+    unsigned pc = hot_pcs[i].second;
+    int f = find(pc);
+    fprintf(stderr, "    %6.2f%% %14llu  0x%08x  ", 100.0 * hot_pcs[i].first / total,
+            hot_pcs[i].first, pc);
+    if (f >= 0)
+      fprintf(stderr, "%s+0x%x\n", functions[f].name.c_str(), pc - functions[f].address);
+    else
+      fprintf(stderr, "??\n");
+  }
+
+  if (callgraph_file)
+    write_callgraph(elf_file);
+
+  if (!dump_file)
+    return;
+
+  //One record per line, tab separated: kind, address, count, symbol.
+  if (!(dump = fopen(dump_file, "w"))) {
+    AC_ERROR("Cannot write the profile to " << dump_file << ": " << strerror(errno));
+    return;
+  }
+  fprintf(dump, "# ArchC execution profile of %s\n", elf_file ? elf_file : "??");
+  fprintf(dump, "# kind\taddress\tcount\tsymbol\n");
+  for (i = 0; i < functions.size(); i++)
+    if (functions[i].count)
+      fprintf(dump, "fn\t0x%08x\t%llu\t%s\n", functions[i].address, functions[i].count,
+              functions[i].name.c_str());
+  for (i = 0; i < size; i++) {
+    if (!counts[i])
+      continue;
+    int f = find(i);
+    if (f >= 0)
+      fprintf(dump, "pc\t0x%08x\t%llu\t%s+0x%x\n", i, counts[i], functions[f].name.c_str(),
+              i - functions[f].address);
+    else
+      fprintf(dump, "pc\t0x%08x\t%llu\t??\n", i, counts[i]);
+  }
+  fclose(dump);
+  fprintf(stderr, "    Profile written to %s\n", dump_file);
+}
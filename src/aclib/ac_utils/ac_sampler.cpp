@@ -0,0 +1,194 @@
+/**
+ * @file      ac_sampler.cpp
+ * @author    The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ * @date      Mon, 19 Oct 2026 16:20:37 -0300
+ *
+ * @brief     Sampled simulation: functional fast-forward alternating
+ *            with detailed measurement windows.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "ac_sampler.H"
+
+ac_sampler::phase_t ac_sampler::phase = ac_sampler::WINDOW;
+unsigned long long ac_sampler::fast_forward = 0;
+unsigned long long ac_sampler::warmup = 0;
+unsigned long long ac_sampler::window = 0;
+unsigned long long ac_sampler::window_start = 0;
+std::vector<double> ac_sampler::cpi;
+std::vector<ac_sampler::metric> ac_sampler::metrics;
+
+bool ac_sampler::enabled = false;
+bool ac_sampler::detailed = true;
+bool ac_sampler::measuring = true;
+unsigned long long ac_sampler::cycles = 0;
+unsigned long long ac_sampler::next_switch = ~0ULL;
+
+//Two-sided 95% quantiles of Student's t distribution for 1 to 30 degrees
+//of freedom. The normal quantile is used above that.
+static const double t_quantile[] = {
+  12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+  2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+  2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+//Mean and half width of the 95% confidence interval of the samples.
+static void estimate(const std::vector<double>& s, double& mean, double& error) {
+  unsigned n = s.size();
+  double sum = 0, squares = 0;
+
+  for (unsigned i = 0; i < n; i++)
+    sum += s[i];
+  mean = sum / n;
+
+  if (n < 2) {
+    error = 0;
+    return;
+  }
+  for (unsigned i = 0; i < n; i++)
+    squares += (s[i] - mean) * (s[i] - mean);
+  error = (n - 1 <= 30 ? t_quantile[n - 2] : 1.960) * sqrt(squares / (n - 1) / n);
+}
+
+bool ac_sampler::configure(const char* spec) {
+  char *sep;
+
+  fast_forward = strtoull(spec, &sep, 10);
+  if (*sep != ':')
+    return false;
+  warmup = strtoull(sep + 1, &sep, 10);
+  if (*sep != ':')
+    return false;
+  window = strtoull(sep + 1, &sep, 10);
+  if (*sep || !window)
+    return false;
+
+  //The run starts fast-forwarding: next_phase() from WINDOW goes there.
+  enabled = true;
+  phase = WINDOW;
+  next_phase(0);
+  return true;
+}
+
+unsigned long long ac_sampler::length(phase_t p) {
+  switch (p) {
+  case FAST_FORWARD:
+    return fast_forward;
+  case WARMUP:
+    return warmup;
+  default:
+    return window;
+  }
+}
+
+void ac_sampler::next_phase(unsigned long long instr_counter) {
+  do {
+    switch (phase) {
+    case FAST_FORWARD:
+      phase = WARMUP;
+      detailed = true;
+      break;
+
+    case WARMUP:
+      phase = WINDOW;
+      measuring = true;
+      cycles = 0;
+      window_start = instr_counter;
+      for (unsigned i = 0; i < metrics.size(); i++) {
+        metrics[i].events_start = *metrics[i].events;
+        metrics[i].total_start = *metrics[i].total;
+      }
+      break;
+
+    case WINDOW:
+      //configure() also comes here, before any window was run.
+      if (instr_counter > window_start) {
+        cpi.push_back((double) cycles / (instr_counter - window_start));
+        for (unsigned i = 0; i < metrics.size(); i++) {
+          metric& m = metrics[i];
+          long long total = *m.total - m.total_start;
+          if (total)
+            m.samples.push_back((double) (*m.events - m.events_start) / total);
+        }
+      }
+      phase = FAST_FORWARD;
+      detailed = false;
+      measuring = false;
+      break;
+    }
+  } while (!length(phase));
+
+  next_switch = instr_counter + length(phase);
+}
+
+void ac_sampler::add_ratio(const std::string& name, const long long* events, const long long* total) {
+  metric m;
+
+  m.name = name;
+  m.events = events;
+  m.total = total;
+  m.events_start = *events;
+  m.total_start = *total;
+  metrics.push_back(m);
+}
+
+void ac_sampler::report(unsigned long long instr_counter) {
+  double mean, error;
+
+  if (!enabled)
+    return;
+
+  //A window cut short by the end of the program is a valid sample too.
+  if (phase == WINDOW)
+    next_phase(instr_counter);
+
+  fprintf(stderr, "ArchC: Sampled statistics (%llu:%llu:%llu)\n",
+          fast_forward, warmup, window);
+  fprintf(stderr, "    Measurement windows: %u\n", (unsigned) cpi.size());
+
+  if (cpi.empty()) {
+    fprintf(stderr, "    (the program ended before the first window)\n");
+    return;
+  }
+  if (cpi.size() < 2)
+    fprintf(stderr, "    (at least two windows are needed for confidence intervals)\n");
+
+  estimate(cpi, mean, error);
+  fprintf(stderr, "    CPI: %.4f +- %.4f (95%% confidence)\n", mean, error);
+  fprintf(stderr, "    Estimated cycles: %.0f +- %.0f\n",
+          mean * instr_counter, error * instr_counter);
+
+  for (unsigned i = 0; i < metrics.size(); i++) {
+    if (metrics[i].samples.empty())
+      continue;
+    estimate(metrics[i].samples, mean, error);
+    fprintf(stderr, "    %s: %.4f +- %.4f\n", metrics[i].name.c_str(), mean, error);
+  }
+}
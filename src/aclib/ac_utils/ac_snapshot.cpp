@@ -0,0 +1,144 @@
+/**
+ * @file      ac_snapshot.cpp
+ * @author    The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ * @date      Mon, 19 Oct 2026 17:42:09 -0300
+ *
+ * @brief     Process snapshots for running several continuations of
+ *            a simulation from the same point.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "ac_snapshot.H"
+#include "ac_utils.H"
+
+std::vector<ac_snapshot::variant> ac_snapshot::variants;
+std::vector<pid_t> ac_snapshot::children;
+unsigned long long ac_snapshot::at = 0;
+unsigned ac_snapshot::at_pc = 0;
+bool ac_snapshot::by_pc = false;
+bool ac_snapshot::armed = false;
+
+bool ac_snapshot::configure(const char* spec) {
+  char *end;
+
+  by_pc = !strncmp(spec, "pc:", 3);
+  if (by_pc)
+    at_pc = strtoul(spec + 3, &end, 0);
+  else
+    at = strtoull(spec, &end, 10);
+
+  armed = (end != spec + (by_pc ? 3 : 0)) && !*end;
+  return armed;
+}
+
+bool ac_snapshot::add_variant(const char* spec) {
+  variant v;
+  const char *p = strchr(spec, ',');
+
+  v.name.assign(spec, p ? p - spec : strlen(spec));
+  if (v.name.empty() || v.name.find('/') != std::string::npos)
+    return false;
+
+  while (p) {
+    const char *next = strchr(p + 1, ',');
+    v.options.push_back(std::string(p + 1, next ? next - p - 1 : strlen(p + 1)));
+    p = next;
+  }
+
+  variants.push_back(v);
+  return true;
+}
+
+void ac_snapshot::take(unsigned long long instr_counter, bool host_threads) {
+  armed = false;
+
+  if (host_threads) {
+    AC_ERROR("Snapshots are not supported when modules run on host threads.");
+    return;
+  }
+
+  //Without variants, a single child continues the same run.
+  if (variants.empty())
+    add_variant("snapshot");
+
+  //Whatever is buffered would be printed again by every child.
+  fflush(stdout);
+  fflush(stderr);
+  cout.flush();
+  cerr.flush();
+
+  for (unsigned i = 0; i < variants.size(); i++) {
+    variant& v = variants[i];
+    pid_t pid = fork();
+
+    if (pid < 0) {
+      AC_ERROR("Cannot fork variant " << v.name << ": " << strerror(errno));
+      continue;
+    }
+
+    if (pid == 0) {
+      std::string out = v.name + ".stdout", err = v.name + ".stderr";
+      int out_fd = open(out.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      int err_fd = open(err.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+      if (out_fd < 0 || err_fd < 0) {
+        AC_ERROR("Cannot create the output files of variant " << v.name << ": " << strerror(errno));
+        _exit(1);
+      }
+      dup2(out_fd, 1);
+      dup2(err_fd, 2);
+      close(out_fd);
+      close(err_fd);
+
+      children.clear();
+      for (unsigned o = 0; o < v.options.size(); o++)
+        if (!ac_run_opt(v.options[o].c_str())) {
+          AC_ERROR("Option not allowed in a variant: " << v.options[o]);
+          exit(1);
+        }
+
+      fprintf(stderr, "ArchC: Variant %s forked after %llu instructions\n",
+              v.name.c_str(), instr_counter);
+      variants.clear();
+      return;
+    }
+
+    children.push_back(pid);
+  }
+
+  if (!children.empty())
+    atexit(wait_children);
+  fprintf(stderr, "ArchC: Snapshot after %llu instructions, %u variants forked\n",
+          instr_counter, (unsigned) children.size());
+}
+
+void ac_snapshot::wait_children() {
+  for (unsigned i = 0; i < children.size(); i++) {
+    int status;
+    while (waitpid(children[i], &status, 0) < 0 && errno == EINTR)
+      ;
+  }
+}
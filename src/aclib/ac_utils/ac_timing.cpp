@@ -0,0 +1,89 @@
+/**
+ * @file      ac_timing.cpp
+ * @author    The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ * @date      Mon, 19 Oct 2026 21:05:17 -0300
+ *
+ * @brief     Host time spent in each phase of the simulation.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "ac_timing.H"
+
+ac_timing::phase ac_timing::current = ac_timing::ELABORATION;
+double ac_timing::last = ac_timing::now();
+double ac_timing::spent[ac_timing::PHASES];
+
+//!System calls of the cores switch phases from their own host threads in
+//!parallel mode, so the switches are serialized.
+static pthread_mutex_t timing_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char* phase_names[ac_timing::PHASES] = {
+  "elaboration", "decoder", "program load", "dynamic linking", "execution", "system calls", "shutdown"
+};
+
+double ac_timing::now() {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+ac_timing::phase ac_timing::enter(phase p) {
+  double t = now();
+  phase previous;
+
+  pthread_mutex_lock(&timing_lock);
+  previous = current;
+  spent[current] += t - last;
+  last = t;
+  current = p;
+  pthread_mutex_unlock(&timing_lock);
+  return previous;
+}
+
+double ac_timing::seconds(phase p) {
+  double s;
+
+  pthread_mutex_lock(&timing_lock);
+  s = spent[p] + ((p == current) ? now() - last : 0);
+  pthread_mutex_unlock(&timing_lock);
+  return s;
+}
+
+void ac_timing::report(unsigned long long instr_counter) {
+  double execution = seconds(EXECUTION);
+
+  fprintf(stderr, "    Host time per phase:\n");
+  for (int p = 0; p < PHASES; p++)
+    fprintf(stderr, "      %-16s %12.6f s\n", phase_names[p], seconds((phase) p));
+
+  if (execution > 0)
+    fprintf(stderr, "    Simulation speed: %.3f MIPS (execution phase)\n", instr_counter / execution / 1e6);
+}
@@ -35,6 +35,12 @@
  */
 
 #include "ac_utils.H"
+#include "ac_checkpoint.H"
+#include "ac_sampler.H"
+#include "ac_snapshot.H"
+#include "ac_profile.H"
+#include "ac_interval_stats.H"
+#include "ac_rtld.H"
 
 #ifdef USE_GDB
 #include "ac_gdb.H"
@@ -62,6 +68,8 @@ int ac_argc;
 char **ac_argv;
 //Name of the file containing the application to be loaded.
 char *appfilename;
+//Instruction batch bounds given with --batch (0 if not given).
+unsigned int ac_batch_min = 0, ac_batch_max = 0;
 
 //Read model options before application
 void ac_init_opt( int ac, char* av[]){
@@ -81,6 +89,26 @@ void ac_init_opt( int ac, char* av[]){
       cerr << "  --help                  Display this help message\n";
       cerr << "  --version               Display ArchC version and options used when built\n";
       cerr << "  --load=<prog_path>      Load target application\n";
+      cerr << "  --batch=<n>             Run <n> instructions between synchronizations\n";
+      cerr << "  --batch=<min>:<max>     Adapt the batch size between <min> and <max>\n";
+      cerr << "  --checkpoint=<file>[:<n>]  Save a checkpoint after <n> instructions or on SIGUSR2\n";
+      cerr << "                          (<n> is required in simulators with GDB support)\n";
+      cerr << "  --restore=<file>        Resume from a checkpoint of the same model and application\n";
+      cerr << "  --sample=<ff>:<warm>:<win>  Fast-forward <ff> instructions, warm caches for <warm>,\n";
+      cerr << "                          then measure <win>, repeatedly\n";
+      cerr << "  --stdin=<file>          Read the standard input of the application from <file>\n";
+      cerr << "  --stats-interval=<file>:<n>[ns]  Write the statistics to <file> every <n>\n";
+      cerr << "                          instructions (or simulated ns), as CSV if <file> is *.csv\n";
+      cerr << "                          and JSON Lines otherwise\n";
+      cerr << "  --snapshot=<n>|pc:<addr>  Fork the variants after <n> instructions or at <addr>\n";
+      cerr << "  --variant=<name>[,<opt>...]  Variant writing <name>.stdout and <name>.stderr, with\n";
+      cerr << "                          its own --checkpoint, --sample, --stdin or\n";
+      cerr << "                          --stats-interval options\n";
+      cerr << "  --profile=<file>        Write the execution profile to <file> (simulators built with --profile)\n";
+      cerr << "  --callgraph=<file>      Write the call graph to <file> in callgrind format (idem)\n";
+      cerr << "  --lazy-bind             Bind the functions of shared libraries on their first call\n";
+      cerr << "  --rtld-cache=<dir>      Keep the linked images of shared libraries in <dir>, so later\n";
+      cerr << "                          runs of the same application skip dynamic linking\n";
 #ifdef USE_GDB
 //      cerr << "  --gdb[=<port>]          Enable GDB support\n";
 #endif /* USE_GDB */
@@ -95,6 +123,47 @@ void ac_init_opt( int ac, char* av[]){
   }
 }
 
+//Options that snapshot variants may give too. Returns false for the others.
+bool ac_run_opt( const char* opt){
+
+  int size = strlen(opt);
+
+  if( (size>13) && (!strncmp( opt, "--checkpoint=", 13))){  //Checkpoint file and count
+    char *sep;
+    ac_checkpoint::save_file = strdup(opt+13);
+    sep = strrchr(ac_checkpoint::save_file, ':');
+    if( sep && sep[1] && strspn(sep+1, "0123456789") == strlen(sep+1) ){
+      ac_checkpoint::save_at = strtoull(sep+1, NULL, 10);
+      *sep = '\0';
+    }
+  }
+  else if( (size>9) && (!strncmp( opt, "--sample=", 9))){  //Sampled simulation
+    if( !ac_sampler::configure(opt+9) ){
+      AC_ERROR("Invalid sampling parameters: " << opt+9);
+      exit(1);
+    }
+  }
+  else if( (size>17) && (!strncmp( opt, "--stats-interval=", 17))){  //Interval statistics
+    if( !ac_interval_stats::configure(opt+17) ){
+      AC_ERROR("Invalid statistics interval: " << opt+17);
+      exit(1);
+    }
+  }
+  else if( (size>8) && (!strncmp( opt, "--stdin=", 8))){  //Standard input of the application
+    int fd = open(opt+8, O_RDONLY);
+    if( fd < 0 ){
+      AC_ERROR("Cannot open " << opt+8 << ": " << strerror(errno));
+      exit(1);
+    }
+    dup2(fd, 0);
+    close(fd);
+  }
+  else
+    return false;
+
+  return true;
+}
+
 //Initialize application
 void ac_init_app( int ac, char* av[]){
 
@@ -125,6 +194,49 @@ void ac_init_app( int ac, char* av[]){
       appfilename = (char*) malloc(sizeof(char)*(size - 6));
       strcpy(appfilename, appname);
     }
+    else if( (size>8) && (!strncmp( av[1], "--batch=", 8))){  //Instruction batch size
+      char *sep;
+      ac_batch_min = ac_batch_max = strtoul(av[1]+8, &sep, 10);
+      if( *sep == ':' )
+        ac_batch_max = strtoul(sep+1, NULL, 10);
+      if( !ac_batch_min || ac_batch_max < ac_batch_min ){
+        AC_ERROR("Invalid batch size: " << av[1]+8);
+        exit(1);
+      }
+    }
+    else if( (size>10) && (!strncmp( av[1], "--restore=", 10))){  //Checkpoint to resume from
+      ac_checkpoint::restore_file = strdup(av[1]+10);
+    }
+    else if( (size>10) && (!strncmp( av[1], "--profile=", 10))){  //Execution profile dump
+      ac_profile::dump_file = strdup(av[1]+10);
+    }
+    else if( (size>12) && (!strncmp( av[1], "--callgraph=", 12))){  //Call graph dump
+      ac_profile::callgraph_file = strdup(av[1]+12);
+    }
+    else if( (size==11) && (!strncmp( av[1], "--lazy-bind", 11))){  //Lazy PLT binding
+      if( !ac_dynlink::ac_rtld::lazy_traps ){
+        AC_ERROR("--lazy-bind is only supported by simulators of models with an ABI and without multi-cycle instructions.");
+        exit(1);
+      }
+      ac_dynlink::ac_rtld::lazy_binding = true;
+    }
+    else if( (size>13) && (!strncmp( av[1], "--rtld-cache=", 13))){  //Linked image cache
+      ac_dynlink::ac_rtld::cache_dir = av[1]+13;
+    }
+    else if( (size>11) && (!strncmp( av[1], "--snapshot=", 11))){  //Snapshot point
+      if( !ac_snapshot::configure(av[1]+11) ){
+        AC_ERROR("Invalid snapshot point: " << av[1]+11);
+        exit(1);
+      }
+    }
+    else if( (size>10) && (!strncmp( av[1], "--variant=", 10))){  //Continuation forked at the snapshot
+      if( !ac_snapshot::add_variant(av[1]+10) ){
+        AC_ERROR("Invalid variant: " << av[1]+10);
+        exit(1);
+      }
+    }
+    else if( ac_run_opt(av[1]) ){  //Options a variant may change
+    }
 #ifdef USE_GDB
 //     if( (size>=5) && (!strncmp( av[1], "--gdb", 5))){ //Enable GDB support
 //       int port = 0;
@@ -45,7 +45,7 @@ enum _sto_unit {BYTE = 1, KBYTE = 1024, MBYTE = 1048576, GBYTE = 1073741824};
 typedef enum _sto_unit sto_unit;
 
 /*!type used to identify the kind of list being declared */
-enum _commalist {INSTR_L, STAGE_L, REG_L, PIPE_L, REGBANK_L, CACHE_L, MEM_L, TLM_PORT_L, TLM_INTR_PORT_L, INSTR_REF_L};
+enum _commalist {INSTR_L, STAGE_L, REG_L, PIPE_L, REGBANK_L, CACHE_L, MEM_L, TLM_PORT_L, TLM_INTR_PORT_L, TLM2_PORT_L, INSTR_REF_L};
 typedef enum _commalist commalist;
 
 /*!type used to identify which description is being parsed */
@@ -172,6 +172,7 @@ static void yywarn(const char* format, ...)
 /* ARCH Tokens */
 %token <text> AC_ARCH
 %token <text> AC_TLM_PORT
+%token <text> AC_TLM2_PORT
 %token <text> AC_TLM_INTR_PORT
 %token <text> AC_CACHE
 %token <text> AC_ICACHE
@@ -195,7 +196,7 @@ static void yywarn(const char* format, ...)
 /* ARCH non-terminals */
 %type <text> archdec archdecbody stagedec pipedec declist worddec fetchdec archctordec
 %type <text> storagedec storagelist memdec regbankdec cachedec cachenparm
-%type <text> portdec intrportdec
+%type <text> portdec tlm2portdec intrportdec
 %type <text> cachesparm cacheobjdec cacheobjdec1 regdec assignregparm assignwidth
 /*** Experimental feature. --Marilia
 %type <text> bufferdec fetchbufferdec
@@ -806,6 +807,7 @@ storagedec: cachedec
       | regbankdec
       | regdec
       | portdec
+      | tlm2portdec
       | intrportdec
 /*** Experimental feature. --Marilia
       | bufferdec
@@ -839,6 +841,20 @@ portdec: AC_TLM_PORT ID COLON INT unit
       storagelist SEMICOLON
       ;
 
+/* TLM-2.0 port declaration */
+tlm2portdec: AC_TLM2_PORT ID COLON INT unit
+      {
+       /* Including port in storage list */
+       if (!add_storage($2, ($4 * current_unit), (ac_sto_types) TLM2_PORT, NULL, error_msg))
+        yyerror(error_msg);
+       if (!add_symbol($2, GEN_ID, (void*) storage_list_tail))
+        yyerror("Redefinition of %s", $2);
+       list_type = TLM2_PORT_L;
+       HaveTLM2Ports = 1;
+      }
+      storagelist SEMICOLON
+      ;
+
 /* Interruption Port declaration */
 intrportdec: AC_TLM_INTR_PORT ID
       {
@@ -988,6 +1004,13 @@ storagelist: COMMA ID COLON INT
         if (!add_symbol($2, GEN_ID, (void*) storage_list_tail))
          yyerror("Redefinition of %s", $2);
        }
+       else if (list_type == TLM2_PORT_L)
+       {
+        if (!add_storage($2, ($4 * current_unit), (ac_sto_types) TLM2_PORT, NULL, error_msg))
+         yyerror(error_msg);
+        if (!add_symbol($2, GEN_ID, (void*) storage_list_tail))
+         yyerror("Redefinition of %s", $2);
+       }
        else if (list_type == TLM_INTR_PORT_L)
        {
         if (!add_storage($2, $4, (ac_sto_types) TLM_INTR_PORT, NULL, error_msg))
@@ -998,7 +1021,7 @@ storagelist: COMMA ID COLON INT
        else
        {
         /* Should never enter here. */
-        yyerror("Internal Bug. Invalid list type. It should be CACHE_L, REGBANK_L, MEM_L, TLM_PORT_L or TLM_INTR_PORT_L");
+        yyerror("Internal Bug. Invalid list type. It should be CACHE_L, REGBANK_L, MEM_L, TLM_PORT_L, TLM2_PORT_L or TLM_INTR_PORT_L");
        }
       }
       | /* empty string */ {}
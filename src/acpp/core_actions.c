@@ -73,6 +73,7 @@ ac_sto_list* tlm_intr_port_list_tail;
 int HaveFormattedRegs, HaveMultiCycleIns, HaveMemHier, HaveCycleRange;
 int ControlInstrInfoLevel;
 int HaveTLMPorts;
+int HaveTLM2Ports;
 int HaveTLMIntrPorts;
 
 int instr_num;
@@ -126,6 +127,7 @@ void init_core_actions()
   HaveCycleRange = 0;
   ControlInstrInfoLevel = 0;
   HaveTLMPorts = 0;
+  HaveTLM2Ports = 0;
   HaveTLMIntrPorts = 0;
 
   instr_num = 0;
@@ -99,6 +99,7 @@ extern ac_sto_list* tlm_intr_port_list_tail;
 extern int HaveFormattedRegs, HaveMultiCycleIns, HaveMemHier, HaveCycleRange;
 extern int ControlInstrInfoLevel;
 extern int HaveTLMPorts;
+extern int HaveTLM2Ports;
 extern int HaveTLMIntrPorts;
 
 extern int instr_num;    //!< Number of Instructions
@@ -60,6 +60,8 @@ int  ACVerifyFlag=0;                            //!<Indicates whether verificati
 int  ACVerifyTimedFlag=0;                       //!<Indicates whether verification option is turned on for a timed behavioral model
 int  ACGDBIntegrationFlag=0;                    //!<Indicates whether gdb support will be included in the simulator
 int  ACWaitFlag=1;                              //!<Indicates whether the instruction execution thread issues a wait() call or not
+int  ACStandaloneFlag=0;                        //!<Indicates whether the simulator is generated without SystemC or not
+int  ACProfileFlag=0;                           //!<Indicates whether the simulator counts executed instructions per address or not
 
 //char *ACVersion = "2.0alpha1";                        //!<Stores ArchC version number.
 char ACOptions[500];                            //!<Stores ArchC recognized command line options
@@ -90,6 +92,12 @@ ac_decoder_full *decoder;
 /*!Storage device used for loading applications */
 ac_sto_list* load_device=0;
 
+/*!Indicates whether the model state can be checkpointed or not */
+int HaveCheckpoints=0;
+
+/*!Indicates whether the simulator supports sampled simulation (--sample) or not */
+int HaveSampling=0;
+
 /*! This is the table of mappings.  Mappings are tried sequentially
   for each option encountered; the first one that matches, wins.  */
 struct option_map option_map[] = {
@@ -104,6 +112,8 @@ struct option_map option_map[] = {
   {"--version"       , "-vrs"        ,"Display ACSIM version.", 0},
   {"--gdb-integration", "-gdb"       ,"Enable support for debbuging programs running on the simulator.", 0},
   {"--no-wait"       , "-nw"        ,"Disable wait() at execution thread.", 0},
+  {"--standalone"    , "-sa"        ,"Generate a SystemC-free simulator driven by a plain main().", 0},
+  {"--profile"       , "-pf"        ,"Count executed instructions per address, reported by function.", "o"},
   0
 };
 
@@ -198,6 +208,7 @@ int main(int argc, char** argv) {
   ac_pipe_list *ppipe;
   extern int HaveFormattedRegs;
   extern int HaveTLMIntrPorts;
+  extern int HaveMultiCycleIns, HaveMemHier, HaveTLMPorts, HaveTLM2Ports;
   extern ac_decoder_full *decoder;
 
   //Uncomment the line bellow if you want to debug the parser.
@@ -296,6 +307,15 @@ int main(int argc, char** argv) {
               ACWaitFlag = 0;
               ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
               break;
+            case OPStandalone:
+              ACStandaloneFlag = 1;
+              ACWaitFlag = 0;   //There is no kernel to wait() on
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPProfile:
+              ACProfileFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
 
             default:
               break;
@@ -345,6 +365,31 @@ int main(int argc, char** argv) {
   }
   acppUnload();
 
+  //Standalone simulators have no SystemC kernel, so anything that relies
+  //on signals, events or simulated time is refused.
+  if (!error_flag && ACStandaloneFlag &&
+      (stage_list || pipe_list || HaveMultiCycleIns || HaveMemHier ||
+       HaveTLMPorts || HaveTLM2Ports || HaveTLMIntrPorts ||
+       ACVerboseFlag || ACVerifyFlag || ACVerifyTimedFlag)) {
+    AC_ERROR("--standalone is only supported for functional models without pipelines, multi-cycle instructions, caches, TLM ports or verification.\n");
+    error_flag = 1;
+  }
+
+  //The profile is kept by the functional loop, one count per instruction.
+  if (!error_flag && ACProfileFlag && (stage_list || pipe_list || HaveMultiCycleIns)) {
+    AC_ERROR("--profile is only supported for models without pipelines or multi-cycle instructions.\n");
+    error_flag = 1;
+  }
+
+  //Checkpoints cover models whose whole state lives in registers, register
+  //banks and plain storage: no pipeline registers, caches or external memory.
+  HaveCheckpoints = !stage_list && !pipe_list && !HaveMultiCycleIns && !HaveMemHier &&
+                    !HaveTLMPorts && !HaveTLM2Ports && !HaveTLMIntrPorts && !ACDelayFlag;
+
+  //Sampling switches modes between instructions, so it needs the functional
+  //loop, where one instruction completes per iteration.
+  HaveSampling = !stage_list && !pipe_list && !HaveMultiCycleIns;
+
   if (error_flag)
     return EXIT_FAILURE;
   else{
@@ -497,7 +542,7 @@ int main(int argc, char** argv) {
     extern char* project_name;
     extern char* upper_project_name;
 
-    extern int HaveFormattedRegs, HaveMultiCycleIns, HaveMemHier, HaveTLMPorts, HaveTLMIntrPorts;
+    extern int HaveFormattedRegs, HaveMultiCycleIns, HaveMemHier, HaveTLMPorts, HaveTLM2Ports, HaveTLMIntrPorts;
 
     ac_sto_list *pstorage;
     ac_stg_list *pstage;
@@ -529,6 +574,9 @@ int main(int argc, char** argv) {
     if (HaveTLMPorts)
       fprintf(output, "#include  \"ac_tlm_port.H\"\n");
 
+    if (HaveTLM2Ports)
+      fprintf(output, "#include  \"ac_tlm2_port.H\"\n");
+
     if (HaveTLMIntrPorts)
       fprintf(output, "#include  \"ac_tlm_intr_port.H\"\n");
 
@@ -551,6 +599,12 @@ int main(int argc, char** argv) {
     COMMENT(INDENT[1], "Program Counter.");
     fprintf(output, "%sac_reg<unsigned> ac_pc;\n\n", INDENT[1]);
 
+    /* Declaring the local time of the processor, shared by its TLM-2.0 ports */
+    if (HaveTLM2Ports) {
+      COMMENT(INDENT[1], "Local time, ahead of the kernel by at most the global quantum.");
+      fprintf(output, "%stlm_utils::tlm_quantumkeeper quantum_keeper;\n\n", INDENT[1]);
+    }
+
     /* Declaring storage devices */
     COMMENT(INDENT[1],"Storage Devices.");
     for( pstorage = storage_list; pstorage != NULL; pstorage=pstorage->next){
@@ -648,6 +702,11 @@ int main(int argc, char** argv) {
 	fprintf(output, "%sac_memport<%s_parms::ac_word, %s_parms::ac_Hword> %s;\n", INDENT[1], project_name, project_name, pstorage->name);
 	break;
 
+      case TLM2_PORT:
+	fprintf(output, "%sac_tlm2_port %s_port;\n", INDENT[1], pstorage->name);
+	fprintf(output, "%sac_memport<%s_parms::ac_word, %s_parms::ac_Hword> %s;\n", INDENT[1], project_name, project_name, pstorage->name);
+	break;
+
       default:
 	fprintf( output, "%sac_storage %s_stg;\n", INDENT[1], pstorage->name);
 	fprintf(output, "%sac_memport<%s_parms::ac_word, %s_parms::ac_Hword> %s;\n", INDENT[1], project_name, project_name, pstorage->name);
@@ -708,6 +767,11 @@ int main(int argc, char** argv) {
     COMMENT(INDENT[1],"Module finalization method.");
     fprintf( output, "%svirtual void stop(int status = 0) = 0;\n\n", INDENT[1]);
 
+    if (HaveCheckpoints) {
+      COMMENT(INDENT[1],"Saves or restores ac_pc and the storage devices.");
+      fprintf( output, "%svoid checkpoint_storage(ac_checkpoint& ck);\n\n", INDENT[1]);
+    }
+
     if (ACGDBIntegrationFlag) {
       COMMENT(INDENT[1], "GDB stub access virtual method declaration.");
       fprintf(output, "%svirtual AC_GDB<%s_parms::ac_word>* get_gdbstub() = 0;\n\n", INDENT[1], project_name);
@@ -1245,7 +1309,9 @@ int main(int argc, char** argv) {
     fprintf( output," {\n");
 
     COMMENT(INDENT[2], "Building Decoder.");
+    fprintf( output,"%sac_timing::phase caller = ac_timing::enter(ac_timing::DECODER);\n", INDENT[2]);
     fprintf( output,"%sdecoder = ac_decoder_full::CreateDecoder(%s_isa::formats, %s_isa::instructions, &ref);\n", INDENT[2], project_name, project_name );
+    fprintf( output,"%sac_timing::enter(caller);\n", INDENT[2]);
 
     /* Closing constructor declaration. */
     fprintf( output,"%s}\n\n", INDENT[1] );
@@ -1537,7 +1603,9 @@ int main(int argc, char** argv) {
     extern int stage_num;
     extern int HaveMultiCycleIns;
     extern int HaveTLMIntrPorts;
+    extern int HaveMemHier, HaveTLMPorts, HaveTLM2Ports;
     extern ac_sto_list *tlm_intr_port_list;
+    extern ac_sto_list *storage_list;
     ac_stg_list *pstage;
     ac_pipe_list *ppipe;
     ac_sto_list *pport;
@@ -1561,9 +1629,12 @@ int main(int argc, char** argv) {
     fprintf( output, "#ifndef  _%s_H\n", upper_project_name);
     fprintf( output, "#define  _%s_H\n\n", upper_project_name);
 
-    fprintf( output, "#include \"systemc.h\"\n");
+    if (!ACStandaloneFlag)
+      fprintf( output, "#include \"systemc.h\"\n");
     fprintf( output, "#include \"ac_module.H\"\n");
     fprintf( output, "#include \"ac_utils.H\"\n");
+    if (ACProfileFlag)
+      fprintf( output, "#include \"ac_profile.H\"\n");
     fprintf( output, "#include \"%s_parms.H\"\n", project_name);
     fprintf( output, "#include \"%s_arch.H\"\n", project_name);
     fprintf( output, "#include \"%s_isa.H\"\n", project_name);
@@ -1626,6 +1697,9 @@ int main(int argc, char** argv) {
       fprintf( output, "%scache_item_t* DEC_CACHE;\n\n", INDENT[1]);
     }
 
+    if(ACProfileFlag)
+      fprintf( output, "%sac_profile profile;\n\n", INDENT[1]);
+
     fprintf( output, "%sunsigned id;\n\n", INDENT[1]);
     fprintf( output, "%sbool start_up;\n", INDENT[1]);
     fprintf( output, "%sunsigned* instr_dec;\n", INDENT[1]);
@@ -1645,7 +1719,8 @@ int main(int argc, char** argv) {
 
     fprintf( output, " \n");
 
-    fprintf( output, "%sSC_HAS_PROCESS( %s );\n\n", INDENT[1], project_name);
+    if (!ACStandaloneFlag)
+      fprintf( output, "%sSC_HAS_PROCESS( %s );\n\n", INDENT[1], project_name);
 
     //!Declaring ARCH Constructor.
     COMMENT(INDENT[1], "Constructor.");
@@ -1662,7 +1737,8 @@ int main(int argc, char** argv) {
 
     fprintf(output, " {\n\n");
 
-    fprintf( output, "%sSC_THREAD( behavior );\n", INDENT[2]);
+    if (!ACStandaloneFlag)
+      fprintf( output, "%sSC_THREAD( behavior );\n", INDENT[2]);
 
     if (ACVerboseFlag || ACVerifyFlag || ACVerifyTimedFlag) {
       fprintf( output, "%sSC_THREAD( ac_verify );\n", INDENT[2]);
@@ -1676,9 +1752,21 @@ int main(int argc, char** argv) {
     fprintf( output, "%sstart_up=1;\n", INDENT[2]);
     fprintf( output, "%sid = %d;\n\n", INDENT[2], 1);
 
+    if (ACDecCacheFlag && ACGDBIntegrationFlag)
+      fprintf( output, "%sDEC_CACHE = 0;\n", INDENT[2]);
+
     if (ACGDBIntegrationFlag)
       fprintf(output, "%sgdbstub = new AC_GDB<%s_parms::ac_word>(this, %s_parms::GDB_PORT_NUM);\n\n", INDENT[2], project_name, project_name);
 
+    //Transports of all the ports of the processor come from one initiator,
+    //and its interrupts are handled on its own host thread in parallel mode
+    for (pport = storage_list; pport != NULL; pport = pport->next)
+      if (pport->type == TLM_PORT || pport->type == TLM2_PORT)
+        fprintf(output, "%s%s_port.set_owner(this);\n", INDENT[2], pport->name);
+    if (HaveTLMIntrPorts)
+      for (pport = tlm_intr_port_list; pport != NULL; pport = pport->next)
+        fprintf(output, "%s%s.set_owner(this);\n", INDENT[2], pport->name);
+
     fprintf( output, "%s}\n", INDENT[1]);  //end constructor
 
     if(ACDecCacheFlag){
@@ -1706,8 +1794,28 @@ int main(int argc, char** argv) {
       fprintf( output, "%sunsigned char mem_read( unsigned int address );\n", INDENT[1]);
       fprintf( output, "%svoid mem_write( unsigned int address, unsigned char byte );\n", INDENT[1]);
 
+      //Block transfers go straight to the loaded memory, unless caches or
+      //ports stand in front of it and the per-byte functions must be used.
+      if (!HaveMemHier && !HaveTLMPorts && !HaveTLM2Ports) {
+        fprintf( output, "%sunsigned int mem_read_block( unsigned int address, unsigned char* buf, unsigned int length ) {\n", INDENT[1]);
+        fprintf( output, "%sreturn APP_MEM->read_block(address, buf, length);\n", INDENT[2]);
+        fprintf( output, "%s}\n", INDENT[1]);
+        fprintf( output, "%svoid mem_write_block( unsigned int address, const unsigned char* buf, unsigned int length ) {\n", INDENT[1]);
+        fprintf( output, "%sAPP_MEM->write_block(address, buf, length);\n", INDENT[2]);
+        fprintf( output, "%s}\n", INDENT[1]);
+      }
+
       fprintf( output, "%s/* GDB stub access */\n", INDENT[1]);
       fprintf( output, "%sAC_GDB<%s_parms::ac_word>* get_gdbstub();\n", INDENT[1], project_name);
+
+      //Breakpoints are flagged in the decode cache entries, once it exists.
+      if (ACDecCacheFlag) {
+        fprintf( output, "%s/* Breakpoint support */\n", INDENT[1]);
+        fprintf( output, "%svoid mark_breakpoint( unsigned int address, bool set ) {\n", INDENT[1]);
+        fprintf( output, "%sif (DEC_CACHE && address < dec_cache_size)\n", INDENT[2]);
+        fprintf( output, "%sDEC_CACHE[address].breakpoint = set;\n", INDENT[3]);
+        fprintf( output, "%s}\n", INDENT[1]);
+      }
     }
 
 
@@ -1824,6 +1932,12 @@ void CreateRegsHeader() {
 
       fprintf( output,"%svoid change_dump(ostream& output){}\n\n",INDENT[1] );
       fprintf( output,"%svoid reset_log(){}\n\n",INDENT[1] );
+      fprintf( output,"%svoid checkpoint(ac_checkpoint& ck)\n",INDENT[1] );
+      fprintf( output,"%s{\n",INDENT[1] );
+      for( pfield = pformat->fields; pfield != NULL; pfield = pfield->next) {
+        fprintf( output,"%s%s.checkpoint(ck);\n", INDENT[2], pfield->name);
+      }
+      fprintf( output,"%s}\n\n",INDENT[1] );
       if (ACDelayFlag) {
         fprintf( output,"%svoid commit_delays(double time)\n",INDENT[1] );
         fprintf( output,"%s{\n",INDENT[1] );
@@ -2134,7 +2248,7 @@ void CreateProcessorImpl() {
   extern ac_sto_list *storage_list;
   extern char *project_name;
   extern int stage_num;
-  extern int HaveMultiCycleIns, HaveMemHier;
+  extern int HaveMultiCycleIns, HaveMemHier, HaveTLM2Ports;
   extern int ACGDBIntegrationFlag;
   ac_sto_list *pstorage;
   ac_stg_list *pstage;
@@ -2185,6 +2299,12 @@ void CreateProcessorImpl() {
 /*     fprintf( output, "%schar fetch[AC_WORDSIZE/8];\n\n", INDENT[1]); */
 /*   } */
 
+  /* In parallel mode the loop below runs on a host thread of its own */
+  if( !stage_list && !pipe_list && ACWaitFlag ){
+    fprintf(output, "%sif (run_on_host_thread())\n", INDENT[1]);
+    fprintf(output, "%sreturn;\n\n", INDENT[2]);
+  }
+
   /* Delayed program loading */
   fprintf(output, "%sif (has_delayed_load) {\n", INDENT[1]);
   fprintf(output, "%sAPP_MEM->load(delayed_load_program);\n", INDENT[2]);
@@ -2194,6 +2314,11 @@ void CreateProcessorImpl() {
 
   if( HaveMemHier ) {
     fprintf( output, "%sif( ac_wait_sig ) {\n", INDENT[1]);
+    if( HaveSampling ){
+      //Stall cycles are part of the window CPI.
+      fprintf( output, "%sif (ac_sampler::measuring)\n", INDENT[2]);
+      fprintf( output, "%sac_sampler::cycles++;\n", INDENT[3]);
+    }
     fprintf( output, "%sreturn;\n", INDENT[2]);
     fprintf( output, "%s}\n\n", INDENT[1]);
   }
@@ -2361,6 +2486,21 @@ void CreateProcessorImpl() {
   fprintf(output, "#ifdef USE_GDB\n");
   fprintf(output, "%ssignal(SIGUSR2, sigusr2_handler);\n", INDENT[1]);
   fprintf(output, "#endif\n");
+  //Process-wide state the host threads of parallel mode would share
+  if (HaveMemHier)
+    fprintf(output, "%skeep_serial(\"the memory hierarchy\");\n", INDENT[1]);
+  if (HaveSampling) {
+    fprintf(output, "%sif (ac_sampler::enabled)\n", INDENT[1]);
+    fprintf(output, "%skeep_serial(\"sampling\");\n", INDENT[2]);
+  }
+  fprintf(output, "%sif (ac_interval_stats::file_name)\n", INDENT[1]);
+  fprintf(output, "%skeep_serial(\"--stats-interval\");\n", INDENT[2]);
+  //Left at zero, the global quantum would send every batch back to the kernel
+  if (HaveTLM2Ports) {
+    fprintf(output, "%sif (tlm::tlm_global_quantum::instance().get() == SC_ZERO_TIME)\n", INDENT[1]);
+    fprintf(output, "%stlm::tlm_global_quantum::instance().set(sc_time(1, SC_US));\n", INDENT[2]);
+    fprintf(output, "%squantum_keeper.reset();\n", INDENT[1]);
+  }
   fprintf(output, "#ifndef AC_COMPSIM\n");
   fprintf(output, "%sset_running();\n", INDENT[1]);
   fprintf(output, "#else\n");
@@ -2373,8 +2513,15 @@ void CreateProcessorImpl() {
   /* init() with 3 parameters */
   fprintf(output, "void %s::init(int ac, char *av[]) {\n", project_name);
   fprintf(output, "%sextern char* appfilename;\n", INDENT[1]);
+  fprintf(output, "%sextern unsigned int ac_batch_min, ac_batch_max;\n", INDENT[1]);
+  fprintf(output, "%sac_timing::enter(ac_timing::LOAD);\n", INDENT[1]);
+  //Only the behavior emitted by EmitProcessorBhv_ABI binds lazy PLT slots
+  if (ACABIFlag && !HaveMultiCycleIns)
+    fprintf(output, "%sac_dynlink::ac_rtld::lazy_traps = true;\n", INDENT[1]);
   fprintf(output, "%sac_init_opt( ac, av);\n", INDENT[1]);
   fprintf(output, "%sac_init_app( ac, av);\n", INDENT[1]);
+  fprintf(output, "%sif (ac_batch_max)\n", INDENT[1]);
+  fprintf(output, "%sset_instr_batch_size(ac_batch_min, ac_batch_max);\n", INDENT[2]);
   fprintf(output, "%sAPP_MEM->load(appfilename);\n", INDENT[1]);
   fprintf(output, "%sset_args(ac_argc, ac_argv);\n", INDENT[1]);
   fprintf(output, "#ifdef AC_VERIFY\n");
@@ -2383,6 +2530,8 @@ void CreateProcessorImpl() {
 
   fprintf(output, "%sac_pc = ac_start_addr;\n", INDENT[1]);
   fprintf(output, "%sISA._behavior_begin();\n", INDENT[1]);
+  fprintf(output, "%sif (ac_checkpoint::restore_file)\n", INDENT[1]);
+  fprintf(output, "%srestore_checkpoint();\n", INDENT[2]);
   fprintf(output, "%scerr << \"ArchC: -------------------- Starting Simulation --------------------\" << endl;\n", INDENT[1]);
   fprintf(output, "%sInitStat();\n\n", INDENT[1]);
 
@@ -2390,9 +2539,33 @@ void CreateProcessorImpl() {
   fprintf(output, "%ssignal(SIGTERM, sigint_handler);\n", INDENT[1]);
   fprintf(output, "%ssignal(SIGSEGV, sigsegv_handler);\n", INDENT[1]);
   fprintf(output, "%ssignal(SIGUSR1, sigusr1_handler);\n", INDENT[1]);
+  //SIGUSR2 belongs to GDB support when there is one, so a checkpoint
+  //can then only be saved at an instruction count
   fprintf(output, "#ifdef USE_GDB\n");
   fprintf(output, "%ssignal(SIGUSR2, sigusr2_handler);\n", INDENT[1]);
+  fprintf(output, "%sif (ac_checkpoint::save_file && (ac_checkpoint::save_at == ~0ULL)) {\n", INDENT[1]);
+  fprintf(output, "%scerr << \"ArchC: SIGUSR2 is used by GDB support in this simulator, so --checkpoint needs an instruction count.\" << endl;\n", INDENT[2]);
+  fprintf(output, "%sexit(EXIT_FAILURE);\n", INDENT[2]);
+  fprintf(output, "%s}\n", INDENT[1]);
+  fprintf(output, "#else\n");
+  fprintf(output, "%sif (ac_checkpoint::save_file)\n", INDENT[1]);
+  fprintf(output, "%ssignal(SIGUSR2, ac_checkpoint::request);\n", INDENT[2]);
   fprintf(output, "#endif\n");
+  //Process-wide state the host threads of parallel mode would share
+  if (HaveMemHier)
+    fprintf(output, "%skeep_serial(\"the memory hierarchy\");\n", INDENT[1]);
+  if (HaveSampling) {
+    fprintf(output, "%sif (ac_sampler::enabled)\n", INDENT[1]);
+    fprintf(output, "%skeep_serial(\"sampling\");\n", INDENT[2]);
+  }
+  fprintf(output, "%sif (ac_interval_stats::file_name)\n", INDENT[1]);
+  fprintf(output, "%skeep_serial(\"--stats-interval\");\n", INDENT[2]);
+  //Left at zero, the global quantum would send every batch back to the kernel
+  if (HaveTLM2Ports) {
+    fprintf(output, "%sif (tlm::tlm_global_quantum::instance().get() == SC_ZERO_TIME)\n", INDENT[1]);
+    fprintf(output, "%stlm::tlm_global_quantum::instance().set(sc_time(1, SC_US));\n", INDENT[2]);
+    fprintf(output, "%squantum_keeper.reset();\n", INDENT[1]);
+  }
   fprintf(output, "#ifndef AC_COMPSIM\n");
   fprintf(output, "%sset_running();\n", INDENT[1]);
   fprintf(output, "#else\n");
@@ -2405,6 +2578,7 @@ void CreateProcessorImpl() {
   /* stop() */
   fprintf(output, "//Stop simulation (may receive exit status)\n");
   fprintf(output, "void %s::stop(int status) {\n", project_name);
+  fprintf(output, "%sac_timing::enter(ac_timing::SHUTDOWN);\n", INDENT[1]);
   fprintf(output, "%scerr << \"ArchC: -------------------- Simulation Finished --------------------\" << endl;\n", INDENT[1]);
   fprintf(output, "%sISA._behavior_end();\n", INDENT[1]);
   fprintf(output, "%sac_stop_flag = 1;\n", INDENT[1]);
@@ -2466,12 +2640,27 @@ void CreateProcessorImpl() {
   fprintf(output, "// Wrapper function to PrintStat().\n");
   fprintf(output, "void %s::PrintStat() {\n", project_name);
   fprintf(output, "%sac_arch<%s_parms::ac_word, %s_parms::ac_Hword>::PrintStat();\n", INDENT[1], project_name, project_name);
+  fprintf(output, "%sac_interval_stats::finish(ac_instr_counter, %s);\n", INDENT[1], SimTimeNs());
+  if (ACProfileFlag) {
+    fprintf(output, "%sextern char* appfilename;\n", INDENT[1]);
+    //With the decode cache, the counts are kept in its entries.
+    if (ACDecCacheFlag) {
+      fprintf(output, "%sif (!start_up) {\n", INDENT[1]);
+      fprintf(output, "%sprofile.init(dec_cache_size);\n", INDENT[2]);
+      fprintf(output, "%sfor (unsigned pc = 0; pc < dec_cache_size; pc++)\n", INDENT[2]);
+      fprintf(output, "%sif (DEC_CACHE[pc].count)\n", INDENT[3]);
+      fprintf(output, "%sprofile.set(pc, DEC_CACHE[pc].count);\n", INDENT[4]);
+      fprintf(output, "%s}\n", INDENT[1]);
+    }
+    fprintf(output, "%sprofile.report(appfilename);\n", INDENT[1]);
+  }
   fprintf(output, "}\n\n");
 
   /* GDB enable method */
   if (ACGDBIntegrationFlag) {
     fprintf(output, "// Enables GDB\n");
     fprintf(output, "void %s::enable_gdb(int port) {\n", project_name);
+    fprintf(output, "%skeep_serial(\"GDB\");\n", INDENT[1]);
     fprintf(output, "%sgdbstub->set_port(port);\n", INDENT[1]);
     fprintf(output, "%sgdbstub->enable();\n", INDENT[1]);
     fprintf(output, "%sgdbstub->connect();\n", INDENT[1]);
@@ -2489,7 +2678,7 @@ void CreateArchImpl() {
   extern ac_pipe_list *pipe_list;
   extern ac_sto_list *storage_list, *fetch_device;
   extern ac_stg_list *stage_list;
-  extern int HaveMultiCycleIns, HaveMemHier, HaveTLMPorts, HaveTLMIntrPorts, reg_width;
+  extern int HaveMultiCycleIns, HaveMemHier, HaveTLMPorts, HaveTLM2Ports, HaveTLMIntrPorts, reg_width;
   extern ac_sto_list* load_device;
 
   extern char *project_name;
@@ -2597,6 +2786,11 @@ void CreateArchImpl() {
       fprintf( output, "%s%s(*this, %s_port)", INDENT[1], pstorage->name, pstorage->name);
       break;
 
+    case TLM2_PORT:
+      fprintf(output, "%s%s_port(\"%s_port\", %uU, quantum_keeper),\n", INDENT[1], pstorage->name, pstorage->name, pstorage->size);
+      fprintf( output, "%s%s(*this, %s_port)", INDENT[1], pstorage->name, pstorage->name);
+      break;
+
     default:
       fprintf(output, "%s%s_stg(\"%s_stg\", %uU),\n", INDENT[1], pstorage->name, pstorage->name, pstorage->size);
       fprintf( output, "%s%s(*this, %s_stg)", INDENT[1], pstorage->name, pstorage->name);
@@ -2656,6 +2850,20 @@ void CreateArchImpl() {
 
   fprintf( output, "}\n\n");
 
+  /* Emitting the storage checkpoint, in declaration order */
+  if (HaveCheckpoints) {
+    fprintf(output, "void %s_arch::checkpoint_storage(ac_checkpoint& ck) {\n", project_name);
+    fprintf(output, "%sck.section(\"storage\");\n", INDENT[1]);
+    fprintf(output, "%sac_pc.checkpoint(ck);\n", INDENT[1]);
+    for( pstorage = storage_list; pstorage != NULL; pstorage=pstorage->next){
+      if (pstorage->type == REG || pstorage->type == REGBANK)
+        fprintf(output, "%s%s.checkpoint(ck);\n", INDENT[1], pstorage->name);
+      else
+        fprintf(output, "%s%s_stg.checkpoint(ck);\n", INDENT[1], pstorage->name);
+    }
+    fprintf(output, "}\n\n");
+  }
+
 }
 
 /*!Create the template for the .cpp file where the user has
@@ -2682,12 +2890,13 @@ void CreateMainTmpl() {
   fprintf( output, "\n");
 
   fprintf( output, "#include  <iostream>\n");
-  fprintf( output, "#include  <systemc.h>\n");
+  if (!ACStandaloneFlag)
+    fprintf( output, "#include  <systemc.h>\n");
   fprintf( output, "#include  \"ac_stats_base.H\"\n");
   fprintf( output, "#include  \"%s.H\"\n\n", project_name);
 
   fprintf( output, "\n\n");
-  fprintf( output, "int sc_main(int ac, char *av[])\n");
+  fprintf( output, "int %s(int ac, char *av[])\n", (ACStandaloneFlag) ? "main" : "sc_main");
   fprintf( output, "{\n\n");
 
   COMMENT(INDENT[1],"%sISA simulator", INDENT[1]);
@@ -2703,7 +2912,10 @@ void CreateMainTmpl() {
   fprintf(output, "%s%s_proc1.init(ac, av);\n", INDENT[1], project_name);
   fprintf(output, "%scerr << endl;\n\n", INDENT[1]);
 
-  fprintf(output, "%ssc_start(-1);\n\n", INDENT[1]);
+  if (ACStandaloneFlag)
+    fprintf(output, "%s%s_proc1.behavior();\n\n", INDENT[1], project_name);
+  else
+    fprintf(output, "%ssc_start(-1);\n\n", INDENT[1]);
 
   fprintf(output, "%s%s_proc1.PrintStat();\n", INDENT[1], project_name);
   fprintf(output, "%scerr << endl;\n\n", INDENT[1]);
@@ -3251,6 +3463,7 @@ void CreateMakefile(){
   extern int HaveMemHier;
   extern int HaveFormattedRegs;
   extern int HaveTLMPorts;
+  extern int HaveTLM2Ports;
   extern int HaveTLMIntrPorts;
   ac_stg_list *pstage;
   ac_pipe_list *ppipe;
@@ -3293,23 +3506,35 @@ void CreateMakefile(){
 
   fprintf( output, "\n\n");
 
-  fprintf( output, "INC_DIR := -I. -I%s -I$(SYSTEMC)/include ", INCLUDEDIR);
-  if (HaveTLMPorts || HaveTLMIntrPorts)
+  fprintf( output, "INC_DIR := -I. -I%s %s", INCLUDEDIR,
+           (ACStandaloneFlag) ? "" : "-I$(SYSTEMC)/include ");
+  if (HaveTLMPorts || HaveTLM2Ports || HaveTLMIntrPorts)
     fprintf(output, "-I%s", TLM_PATH);
   fprintf(output, "\n");
-  fprintf( output, "LIB_DIR := -L. -L$(SYSTEMC)/lib-$(TARGET_ARCH) -L%s\n", LIBDIR);
+  if (ACStandaloneFlag)
+    fprintf( output, "LIB_DIR := -L. -L%s\n", LIBDIR);
+  else
+    fprintf( output, "LIB_DIR := -L. -L$(SYSTEMC)/lib-$(TARGET_ARCH) -L%s\n", LIBDIR);
 
   fprintf( output, "\n");
 
-  fprintf( output, "LIB_SYSTEMC := %s\n",
-           (strlen(SYSTEMC_PATH) > 2) ? "-lsystemc" : "");
-  fprintf( output, "LIBS := $(LIB_SYSTEMC) -lm $(EXTRA_LIBS) -larchc\n");
+  if (ACStandaloneFlag) {
+    //libarchc_standalone goes first so its ac_module wins over libarchc's
+    fprintf( output, "LIBS := -lm $(EXTRA_LIBS) -larchc_standalone -larchc -lpthread\n");
+  }
+  else {
+    fprintf( output, "LIB_SYSTEMC := %s\n",
+             (strlen(SYSTEMC_PATH) > 2) ? "-lsystemc" : "");
+    fprintf( output, "LIBS := $(LIB_SYSTEMC) -lm $(EXTRA_LIBS) -larchc -lpthread\n");
+  }
   fprintf( output, "CC :=  %s\n", CC_PATH);
   fprintf( output, "OPT :=  %s\n", OPT_FLAGS);
   fprintf( output, "DEBUG :=  %s\n", DEBUG_FLAGS);
   fprintf( output, "OTHER :=  %s\n", OTHER_FLAGS);
-  fprintf( output, "CFLAGS := $(DEBUG) $(OPT) $(OTHER) %s\n",
-           (ACGDBIntegrationFlag) ? "-DUSE_GDB" : "" );
+  fprintf( output, "CFLAGS := $(DEBUG) $(OPT) $(OTHER) %s%s%s\n",
+           (ACGDBIntegrationFlag) ? "-DUSE_GDB " : "",
+           (ACStandaloneFlag) ? "-DAC_NO_SYSTEMC " : "",
+           (ACProfileFlag) ? "-DAC_PROFILE" : "" );
 
   fprintf( output, "\n");
 
@@ -3407,6 +3632,8 @@ void CreateMakefile(){
     fprintf(output, "ac_syscall.o ");
   if(HaveTLMPorts)
     fprintf(output, "ac_tlm_port.o ");
+  if(HaveTLM2Ports)
+    fprintf(output, "ac_tlm2_port.o ");
   if(HaveTLMIntrPorts)
     fprintf(output, "ac_tlm_intr_port.o ");
   fprintf(output, "\n\n");
@@ -3414,11 +3641,15 @@ void CreateMakefile(){
   //Declaring FILESHEAD variable
   COMMENT_MAKE("These are the headers files provided by ArchC");
   COMMENT_MAKE("They are stored in the archc/include directory");
-  fprintf( output, "ACFILESHEAD := $(ACFILES:.cpp=.H) ac_decoder_rt.H ac_module.H ac_storage.H ac_utils.H ac_regbank.H ac_debug_model.H ac_sighandlers.H ac_ptr.H ac_memport.H ac_arch.H ac_arch_dec_if.H ac_arch_ref.H ");
+  fprintf( output, "ACFILESHEAD := $(ACFILES:.cpp=.H) ac_decoder_rt.H ac_module.H ac_storage.H ac_utils.H ac_regbank.H ac_debug_model.H ac_sighandlers.H ac_ptr.H ac_memport.H ac_arch.H ac_arch_dec_if.H ac_arch_ref.H ac_systemc.H ac_checkpoint.H ac_sampler.H ac_snapshot.H ac_profile.H ac_interval_stats.H ac_timing.H ");
+  if( HaveMemHier )
+    fprintf(output, "ac_cache_prefetcher.H ");
   if (ACABIFlag)
     fprintf(output, "ac_syscall.H ");
   if (HaveTLMPorts)
     fprintf(output, "ac_tlm_port.H ");
+  if (HaveTLM2Ports)
+    fprintf(output, "ac_tlm2_port.H ");
   if (HaveTLMIntrPorts)
     fprintf(output, "ac_tlm_intr_port.H ");
   if (HaveTLMPorts || HaveTLMIntrPorts)
@@ -3460,7 +3691,7 @@ void CreateMakefile(){
   fprintf( output, " $(ACHEAD) $(ACFILES) $(EXE)\n\n");
 
   fprintf( output, "$(EXE): $(OBJS) %s\n",
-           (strlen(SYSTEMC_PATH) > 2) ? "$(SYSTEMC)/lib-$(TARGET_ARCH)/libsystemc.a" : "");
+           (strlen(SYSTEMC_PATH) > 2 && !ACStandaloneFlag) ? "$(SYSTEMC)/lib-$(TARGET_ARCH)/libsystemc.a" : "");
   fprintf( output, "\t$(CC) $(CFLAGS) $(INC_DIR) $(LIB_DIR) -o $@ $(OBJS) $(LIBS) 2>&1 | c++filt\n\n");
 
   COMMENT_MAKE("Copy from template if main.cpp not exist");
@@ -3948,6 +4179,23 @@ void EmitMultiPipeUpdateMethod( FILE *output){
   fprintf( output, "%s}\n", INDENT[0]);
 }
 
+/**************************************/
+/*!  Returns the expression for the simulated time in ns,
+  or -1 in simulators without a SystemC kernel.
+  \brief Used by the emit functions of the interval statistics */
+/***************************************/
+const char* SimTimeNs(){
+
+  extern int HaveTLM2Ports;
+
+  if (ACStandaloneFlag)
+    return "-1";
+  //The local time of the processor runs ahead of the kernel.
+  if (HaveTLM2Ports)
+    return "quantum_keeper.get_current_time().to_seconds() * 1e9";
+  return "sc_time_stamp().to_seconds() * 1e9";
+}
+
 /**************************************/
 /*!  Emits a method to update pipe regs
   \brief Used by CreateArchImpl function      */
@@ -3955,7 +4203,7 @@ void EmitMultiPipeUpdateMethod( FILE *output){
 void EmitUpdateMethod( FILE *output){
 
   extern char *project_name;
-  extern int HaveMultiCycleIns, HaveMemHier;
+  extern int HaveMultiCycleIns, HaveMemHier, HaveTLM2Ports;
   extern ac_sto_list *storage_list;
   ac_sto_list *pstorage;
 
@@ -3986,12 +4234,28 @@ void EmitUpdateMethod( FILE *output){
   /*   fprintf( output, "%sdo_it = do_it.read()^1;\n", INDENT[2]); */
   /*   fprintf( output, "%s}\n", INDENT[1]); */
 
+  //Only levels with a posted request are serviced, through the completion queue.
   if( HaveMemHier ){
-    for( pstorage = storage_list; pstorage!= NULL; pstorage = pstorage->next ) {
-      if( pstorage->type == CACHE || pstorage->type == ICACHE || pstorage->type == DCACHE || pstorage->type == MEM )
-        fprintf( output, "%s%s.process_request( );\n", INDENT[1], pstorage->name);
-    }
+    fprintf( output, "%sif (ac_cache_if::pending)\n", INDENT[1]);
+    fprintf( output, "%sac_cache_if::process_pending( );\n", INDENT[2]);
+  }
+  if (HaveCheckpoints) {
+    fprintf(output, "%sif (ac_checkpoint::due(ac_instr_counter))\n", INDENT[1]);
+    fprintf(output, "%ssave_checkpoint();\n", INDENT[2]);
+  }
+  if (HaveSampling) {
+    //A phase never ends while a cache miss holds the instruction.
+    if (HaveMemHier)
+      fprintf(output, "%sif (!ac_wait_sig && ac_sampler::due(ac_instr_counter))\n", INDENT[1]);
+    else
+      fprintf(output, "%sif (ac_sampler::due(ac_instr_counter))\n", INDENT[1]);
+    fprintf(output, "%sac_sampler::next_phase(ac_instr_counter);\n", INDENT[2]);
   }
+  //ac_pc holds the next instruction, so a snapshot at a PC is taken before it.
+  fprintf(output, "%sif (ac_snapshot::due(ac_instr_counter, ac_pc))\n", INDENT[1]);
+  fprintf(output, "%sac_snapshot::take(ac_instr_counter, parallel_mode);\n", INDENT[2]);
+  fprintf(output, "%sif (ac_interval_stats::due(ac_instr_counter))\n", INDENT[1]);
+  fprintf(output, "%sac_interval_stats::write(ac_instr_counter, %s);\n", INDENT[2], SimTimeNs());
   fprintf(output, "%sif (ac_stop_flag) {\n", INDENT[1]);
   fprintf( output, "%sreturn;\n", INDENT[2]);
   fprintf( output, "%s}\n", INDENT[1]);
@@ -4005,7 +4269,29 @@ void EmitUpdateMethod( FILE *output){
 
     fprintf( output, "%selse {\n", INDENT[2]);
     fprintf( output, "%sinstr_in_batch = 0;\n", INDENT[3]);
-    fprintf( output, "%swait(1, SC_NS);\n", INDENT[3]);
+    fprintf( output, "%sadapt_instr_batch_size();\n", INDENT[3]);
+    //In parallel mode each batch is one quantum of the host threads.
+    fprintf( output, "%sif (parallel_mode) {\n", INDENT[3]);
+    fprintf( output, "%send_quantum();\n", INDENT[4]);
+    if (HaveTLM2Ports)
+      fprintf( output, "%squantum_keeper.reset();\n", INDENT[4]);
+    fprintf( output, "%s}\n", INDENT[3]);
+    //With TLM-2.0 ports the batch time is only added to the local time,
+    //and the kernel is entered once the quantum is used up.
+    if (HaveTLM2Ports) {
+      fprintf( output, "%selse {\n", INDENT[3]);
+      fprintf( output, "%squantum_keeper.inc(sc_time(1, SC_NS));\n", INDENT[4]);
+      fprintf( output, "%sif (quantum_keeper.need_sync())\n", INDENT[4]);
+      fprintf( output, "%squantum_keeper.sync();\n", INDENT[5]);
+      fprintf( output, "%s}\n", INDENT[3]);
+    }
+    else {
+      fprintf( output, "%selse\n", INDENT[3]);
+      fprintf( output, "%swait(1, SC_NS);\n", INDENT[4]);
+    }
+    //Simulated time only moves between batches.
+    fprintf( output, "%sif (ac_interval_stats::due_time(%s))\n", INDENT[3], SimTimeNs());
+    fprintf( output, "%sac_interval_stats::write(ac_instr_counter, %s);\n", INDENT[4], SimTimeNs());
     fprintf( output, "%s}\n", INDENT[2]);
 
     fprintf(output, "%s}\n\n", INDENT[1]);
@@ -4106,7 +4392,7 @@ void EmitInstrExec( FILE *output, int base_indent){
   extern ac_dec_instr *instr_list;
   extern ac_dec_format *format_ins_list;
   extern ac_dec_field *common_instr_field_list;
-  extern int HaveCycleRange;
+  extern int HaveCycleRange, HaveMemHier, HaveMultiCycleIns;
 
   extern char* project_name;
 
@@ -4114,8 +4400,23 @@ void EmitInstrExec( FILE *output, int base_indent){
   ac_dec_instr *pinstr;
   ac_dec_field *pfield, *pf;
 
-  if( ACGDBIntegrationFlag )
-    fprintf( output, "%sif (gdbstub && gdbstub->stop(decode_pc)) gdbstub->process_bp();\n\n", INDENT[base_indent]);
+  //With the decode cache, only instructions flagged with a breakpoint look it up.
+  if( ACGDBIntegrationFlag && ACDecCacheFlag )
+    fprintf( output, "%sif (gdbstub && (ins_cache->breakpoint || gdbstub->stepping()) && gdbstub->stop(decode_pc)) {\n", INDENT[base_indent]);
+  else if( ACGDBIntegrationFlag )
+    fprintf( output, "%sif (gdbstub && gdbstub->stop(decode_pc)) {\n", INDENT[base_indent]);
+  if( ACGDBIntegrationFlag ){
+    fprintf( output, "%sgdbstub->process_bp();\n", INDENT[base_indent+1]);
+    //GDB moved the PC (reverse execution, "c ADDR"): fetch from there instead.
+    if( !HaveMultiCycleIns && !stage_list && !pipe_list ){
+      fprintf( output, "%sif (ac_pc != decode_pc) {\n", INDENT[base_indent+1]);
+      fprintf( output, "%sgdbstub->restart();\n", INDENT[base_indent+2]);
+      fprintf( output, "%sbhv_pc = ac_pc;\n", INDENT[base_indent+2]);
+      fprintf( output, "%scontinue;\n", INDENT[base_indent+2]);
+      fprintf( output, "%s}\n", INDENT[base_indent+1]);
+    }
+    fprintf( output, "%s}\n\n", INDENT[base_indent]);
+  }
 
   fprintf( output, "%sac_pc = decode_pc;\n\n", INDENT[base_indent]);
 
@@ -4172,8 +4473,28 @@ void EmitInstrExec( FILE *output, int base_indent){
   }
   fprintf(output, "%s} // switch (ins_id)\n", INDENT[base_indent]);
 
+  if( ACProfileFlag ){
+    fprintf( output, "%sif (!ac_annul_sig%s) {\n", INDENT[base_indent], HaveMemHier ? " && !ac_wait_sig" : "");
+    if( ACDecCacheFlag )
+      fprintf( output, "%sins_cache->count++;\n", INDENT[base_indent+1]);
+    else
+      fprintf( output, "%sprofile.hit(decode_pc);\n", INDENT[base_indent+1]);
+    fprintf( output, "%sif (ac_profile::callgraph_file)\n", INDENT[base_indent+1]);
+    fprintf( output, "%sprofile.step(decode_pc, ISA.get_size());\n", INDENT[base_indent+2]);
+    fprintf( output, "%s}\n", INDENT[base_indent]);
+  }
+
+  if( HaveSampling ){
+    fprintf( output, "%sif (ac_sampler::measuring && (!ac_annul_sig) && (!ac_wait_sig))\n", INDENT[base_indent]);
+    fprintf( output, "%sac_sampler::cycles += ISA.get_cycles();\n", INDENT[base_indent+1]);
+  }
+
   if( ACStatsFlag ){
-    fprintf( output, "%sif((!ac_annul_sig) && (!ac_wait_sig)) {\n", INDENT[base_indent]);
+    //Outside the measurement windows of a sampled run no statistics are kept.
+    if( HaveSampling )
+      fprintf( output, "%sif((!ac_annul_sig) && (!ac_wait_sig) && ac_sampler::measuring) {\n", INDENT[base_indent]);
+    else
+      fprintf( output, "%sif((!ac_annul_sig) && (!ac_wait_sig)) {\n", INDENT[base_indent]);
     fprintf( output, "%sISA.stats[%s_stat_ids::INSTRUCTIONS]++;\n", INDENT[base_indent+1], project_name);
     fprintf( output, "%s(*(ISA.instr_stats[ins_id]))[%s_instr_stat_ids::COUNT]++;\n", INDENT[base_indent+1], project_name);
 
@@ -4239,8 +4560,13 @@ void EmitFetchInit( FILE *output, int base_indent){
   if(ACABIFlag)
     fprintf( output, "%sISA.syscall.set_prog_args(argc, argv);\n", INDENT[3]);
   fprintf( output, "%sstart_up=0;\n", INDENT[base_indent+2]);
-  if( ACDecCacheFlag )
+  if( ACDecCacheFlag ){
+    fprintf( output, "%sac_timing::enter(ac_timing::DECODER);\n", INDENT[base_indent+2]);
     fprintf( output, "%sinit_dec_cache();\n", INDENT[base_indent+2]);
+    fprintf( output, "%sac_timing::enter(ac_timing::EXECUTION);\n", INDENT[base_indent+2]);
+  }
+  else if( ACProfileFlag )
+    fprintf( output, "%sprofile.init(APP_MEM->get_size());\n", INDENT[base_indent+2]);
   fprintf( output, "%s}\n", INDENT[base_indent+1]);
 
   fprintf( output, "%selse{ \n", INDENT[base_indent+1]);
@@ -4302,6 +4628,12 @@ void EmitProcessorBhv_ABI( FILE *output){
 
   fprintf( output, "%sdefault:\n\n", INDENT[2]);
 
+  //PLT slots left unbound by the dynamic linker point to trap addresses.
+  fprintf( output, "%sif( ac_dyn_loader.lazy_trap(decode_pc) ){\n", INDENT[3]);
+  fprintf( output, "%sISA.syscall.ac_rtld_bind(decode_pc);\n", INDENT[4]);
+  fprintf( output, "%sbreak;\n", INDENT[4]);
+  fprintf( output, "%s}\n\n", INDENT[3]);
+
   EmitDecodification(output, 2);
   EmitInstrExec(output, 3);
 
@@ -4403,7 +4735,9 @@ void EmitPipeABIDefine( FILE *output){
     fprintf( output, "%strace_file << hex << decode_pc << dec << endl; \\\n", INDENT[5]);
   }
 
+  fprintf( output, "%sac_timing::enter(ac_timing::SYSCALLS); \\\n", INDENT[4]);
   fprintf( output, "%sISA.syscall.NAME(); \\\n", INDENT[4]);
+  fprintf( output, "%sif (ac_timing::in(ac_timing::SYSCALLS)) ac_timing::enter(ac_timing::EXECUTION); \\\n", INDENT[4]);
   fprintf( output, "%sac_instr_counter++; \\\n", INDENT[4]);
   fprintf( output, "%sflushes_left = 7; \\\n", INDENT[4]);
   fprintf( output, "%s} \\\n", INDENT[3]);
@@ -4436,7 +4770,9 @@ void EmitABIDefine( FILE *output){
     fprintf( output, "%strace_file << hex << decode_pc << dec << endl; \\\n", INDENT[5]);
   }
 
+  fprintf( output, "%sac_timing::enter(ac_timing::SYSCALLS); \\\n", INDENT[4]);
   fprintf( output, "%sISA.syscall.NAME(); \\\n", INDENT[4]);
+  fprintf( output, "%sif (ac_timing::in(ac_timing::SYSCALLS)) ac_timing::enter(ac_timing::EXECUTION); \\\n", INDENT[4]);
   fprintf( output, "%sbreak;  \\\n", INDENT[3]);
 }
 
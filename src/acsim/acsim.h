@@ -111,6 +111,8 @@ enum _ac_cmd_options {
   OPVersion,
   OPGDBIntegration,
   OPWait,
+  OPStandalone,
+  OPProfile,
   ACNumberOfOptions
 };
 
@@ -187,6 +189,7 @@ void EmitCacheDeclaration(FILE *output, ac_sto_list* pstorage, int base_indent);
  * @{
  */
 void ReadConfFile(void);                          //!< Read archc.conf contents.
+const char* SimTimeNs(void);                      //!< Emitted expression for the simulated time in ns.
 //@}
 
 